@@ -0,0 +1,212 @@
+
+#include <SFML/System.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include "Condition.hpp"
+
+/*
+ * Measures the latency of the thread handoffs done with sfe::Condition, which
+ * paces the decoding threads.
+ *
+ * - ping-pong: two threads pass a token back and forth, the reported time is
+ *   the average delay between one thread unlocking and the other one waking up
+ * - broadcast: several threads wait for the same value, the reported time is
+ *   the delay until the last of them woke up
+ * - timed wait: nobody changes the value, the reported time is how late the
+ *   waits return compared to their deadline, next to sf::sleep() for reference
+ */
+
+struct Stats {
+	Stats(void) :
+	count(0),
+	total(sf::Time::Zero),
+	max(sf::Time::Zero)
+	{
+	}
+
+	void add(sf::Time time)
+	{
+		count++;
+		total += time;
+
+		if (time > max)
+			max = time;
+	}
+
+	void print(const std::string& name) const
+	{
+		std::cout << std::setw(28) << std::left << name << std::right << std::fixed << std::setprecision(1)
+				  << std::setw(10) << (count ? total.asMicroseconds() / (float)count : 0) << "us avg"
+				  << std::setw(10) << (float)max.asMicroseconds() << "us max" << std::endl;
+	}
+
+	unsigned count;
+	sf::Time total;
+	sf::Time max;
+};
+
+class PingPong {
+public:
+	PingPong(unsigned roundTrips) :
+	m_turn(0),
+	m_roundTrips(roundTrips),
+	m_thread(&PingPong::pong, this)
+	{
+	}
+
+	sf::Time run(void)
+	{
+		sf::Clock timer;
+		m_thread.launch();
+
+		for (unsigned i = 0; i < m_roundTrips; i++)
+		{
+			m_turn.waitAndLock(0);
+			m_turn.unlock(1);
+		}
+
+		m_turn.waitAndLock(0, sfe::Condition::AutoUnlock);
+		sf::Time elapsed = timer.getElapsedTime();
+		m_thread.wait();
+
+		// Two handoffs per round trip
+		return elapsed / (float)(m_roundTrips * 2);
+	}
+
+private:
+	void pong(void)
+	{
+		for (unsigned i = 0; i < m_roundTrips; i++)
+		{
+			m_turn.waitAndLock(1);
+			m_turn.unlock(0);
+		}
+	}
+
+	sfe::Condition m_turn;
+	unsigned m_roundTrips;
+	sf::Thread m_thread;
+};
+
+class BroadcastWaiters {
+public:
+	BroadcastWaiters(unsigned waiterCount) :
+	m_go(0),
+	m_ready(0),
+	m_readyMutex(),
+	m_wakeTimes(waiterCount),
+	m_clock(),
+	m_threads()
+	{
+		for (unsigned i = 0; i < waiterCount; i++)
+			m_threads.push_back(new sf::Thread(&BroadcastWaiters::wait, this));
+	}
+
+	~BroadcastWaiters(void)
+	{
+		for (unsigned i = 0; i < m_threads.size(); i++)
+			delete m_threads[i];
+	}
+
+	sf::Time run(void)
+	{
+		for (unsigned i = 0; i < m_threads.size(); i++)
+			m_threads[i]->launch();
+
+		// Let all the waiters block
+		m_ready.waitAndLock(m_threads.size(), sfe::Condition::AutoUnlock);
+		sf::sleep(sf::milliseconds(10));
+
+		sf::Time start = m_clock.getElapsedTime();
+		m_go.lock();
+		m_go.unlock(1);
+		m_go.broadcast();
+
+		sf::Time last = start;
+
+		for (unsigned i = 0; i < m_threads.size(); i++)
+		{
+			m_threads[i]->wait();
+			last = std::max(last, m_wakeTimes[i]);
+		}
+
+		return last - start;
+	}
+
+private:
+	void wait(void)
+	{
+		unsigned index;
+		{
+			sf::Lock l(m_readyMutex);
+			index = m_ready.value();
+			m_ready = index + 1;
+		}
+
+		m_go.waitAndLock(1, sfe::Condition::AutoUnlock);
+		m_wakeTimes[index] = m_clock.getElapsedTime();
+	}
+
+	sfe::Condition m_go;
+	sfe::Condition m_ready;
+	sf::Mutex m_readyMutex;
+	std::vector<sf::Time> m_wakeTimes;
+	sf::Clock m_clock;
+	std::vector<sf::Thread *> m_threads;
+};
+
+static void measureTimedWaits(sf::Time timeout, unsigned count)
+{
+	sfe::Condition never(0);
+	Stats waitStats;
+	Stats sleepStats;
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		sf::Clock timer;
+		never.waitAndLock(1, timeout);
+		waitStats.add(timer.getElapsedTime() - timeout);
+
+		timer.restart();
+		sf::sleep(timeout);
+		sleepStats.add(timer.getElapsedTime() - timeout);
+	}
+
+	std::ostringstream name;
+	name << timeout.asMilliseconds() << "ms ";
+	waitStats.print(name.str() + "timed wait overshoot");
+	sleepStats.print(name.str() + "sf::sleep overshoot");
+}
+
+int main(int argc, const char *argv[])
+{
+	unsigned roundTrips = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 100000;
+	unsigned waiterCount = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 8;
+
+	Stats pingPong;
+	PingPong test(roundTrips);
+	pingPong.add(test.run());
+	pingPong.print("ping-pong handoff");
+
+	Stats broadcast;
+
+	for (unsigned i = 0; i < 20; i++)
+	{
+		BroadcastWaiters waiters(waiterCount);
+		broadcast.add(waiters.run());
+	}
+
+	std::ostringstream name;
+	name << "broadcast to " << waiterCount << " waiters";
+	broadcast.print(name.str());
+
+	measureTimedWaits(sf::milliseconds(1), 200);
+	measureTimedWaits(sf::milliseconds(5), 100);
+	measureTimedWaits(sf::milliseconds(16), 50);
+
+	return 0;
+}
@@ -0,0 +1,89 @@
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "ProcessStats.hpp"
+
+/*
+ * Compares the per-movie decoding threads with the shared decode pool.
+ *
+ * The given movie is opened several times and all the instances are played
+ * at the same time, first with one decoding thread per movie then with the
+ * shared decode pool. A render loop running at 60 Hz fetches the current frame
+ * of every movie without any window being displayed.
+ *
+ * For each mode the benchmark reports the peak thread count, the amount of
+ * context switches and the total CPU time spent by the process.
+ */
+
+static void runMode(const std::string& movieFile, unsigned movieCount, sf::Time duration, bool usePool)
+{
+	std::vector<sfe::Movie *> movies;
+	sfe::Movie::useSharedDecodePool(usePool);
+
+	for (unsigned i = 0; i < movieCount; i++)
+	{
+		sfe::Movie *movie = new sfe::Movie;
+
+		if (!movie->openFromFile(movieFile))
+		{
+			std::cerr << "Could not open " << movieFile << std::endl;
+			delete movie;
+			break;
+		}
+
+		movies.push_back(movie);
+	}
+
+	ProcessStats before = ProcessStats::current();
+	unsigned peakThreads = before.threadCount;
+	sf::Clock timer;
+
+	for (unsigned i = 0; i < movies.size(); i++)
+		movies[i]->play();
+
+	while (timer.getElapsedTime() < duration)
+	{
+		for (unsigned i = 0; i < movies.size(); i++)
+			movies[i]->getCurrentFrame();
+
+		ProcessStats now = ProcessStats::current();
+		if (now.threadCount > peakThreads)
+			peakThreads = now.threadCount;
+
+		sf::sleep(sf::milliseconds(16));
+	}
+
+	ProcessStats after = ProcessStats::current();
+
+	for (unsigned i = 0; i < movies.size(); i++)
+		delete movies[i];
+
+	std::cout << (usePool ? "shared pool" : "per-movie threads") << ":" << std::endl;
+	std::cout << "  movies:                      " << movies.size() << std::endl;
+	std::cout << "  peak threads:                " << peakThreads << std::endl;
+	std::cout << "  voluntary context switches:  " << (after.voluntaryContextSwitches - before.voluntaryContextSwitches) << std::endl;
+	std::cout << "  involuntary context switches:" << (after.involuntaryContextSwitches - before.involuntaryContextSwitches) << std::endl;
+	std::cout << "  CPU time:                    " << (after.cpuSeconds - before.cpuSeconds) << "s for "
+			  << duration.asSeconds() << "s of playback" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << std::string(argv[0]) << " movie_path [movie_count=16] [seconds=10]" << std::endl;
+		return 1;
+	}
+
+	std::string movieFile = std::string(argv[1]);
+	unsigned movieCount = (argc > 2) ? std::atoi(argv[2]) : 16;
+	sf::Time duration = sf::seconds((argc > 3) ? std::atof(argv[3]) : 10);
+
+	runMode(movieFile, movieCount, duration, false);
+	runMode(movieFile, movieCount, duration, true);
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ *  ProcessStats.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef PROCESS_STATS_HPP
+#define PROCESS_STATS_HPP
+
+#include <SFML/Config.hpp>
+#include <fstream>
+#include <string>
+#include <sstream>
+
+#ifndef SFML_SYSTEM_WINDOWS
+#include <sys/resource.h>
+#endif
+
+/*
+ * Snapshot of the resources used by the current process, used by the
+ * benchmarks to compare playback configurations.
+ *
+ * Thread count, context switches and resident memory are only available on
+ * Linux (read from /proc/self/status) and are left to 0 elsewhere.
+ */
+struct ProcessStats {
+	ProcessStats(void) :
+	threadCount(0),
+	voluntaryContextSwitches(0),
+	involuntaryContextSwitches(0),
+	residentKB(0),
+	cpuSeconds(0)
+	{
+	}
+
+	unsigned threadCount;
+	unsigned long voluntaryContextSwitches;
+	unsigned long involuntaryContextSwitches;
+	unsigned long residentKB;
+	double cpuSeconds;	// User + system time
+
+	static ProcessStats current(void)
+	{
+		ProcessStats stats;
+		std::ifstream status("/proc/self/status");
+		std::string line;
+
+		while (std::getline(status, line))
+		{
+			std::istringstream fields(line);
+			std::string key;
+			fields >> key;
+
+			if (key == "Threads:")
+				fields >> stats.threadCount;
+			else if (key == "voluntary_ctxt_switches:")
+				fields >> stats.voluntaryContextSwitches;
+			else if (key == "nonvoluntary_ctxt_switches:")
+				fields >> stats.involuntaryContextSwitches;
+			else if (key == "VmRSS:")
+				fields >> stats.residentKB;
+		}
+
+#ifndef SFML_SYSTEM_WINDOWS
+		struct rusage usage;
+
+		if (0 == getrusage(RUSAGE_SELF, &usage))
+		{
+			stats.cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+				usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+		}
+#endif
+
+		return stats;
+	}
+};
+
+#endif
@@ -0,0 +1,116 @@
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+/*
+ * Measures the time from openFromFile() to the first displayable frame when
+ * going through a list of clips, as a playlist does.
+ *
+ * The clips are opened in turn, first with a new Movie for each clip then
+ * with a single Movie reopened for every clip, which keeps its frame buffers,
+ * scaler and texture when consecutive clips share the same format.
+ * openFromFile() returns once the first frame has been decoded and uploaded.
+ */
+
+struct OpenTimes {
+	OpenTimes(void) :
+	count(0),
+	total(sf::Time::Zero),
+	max(sf::Time::Zero)
+	{
+	}
+
+	void add(sf::Time time)
+	{
+		count++;
+		total += time;
+
+		if (time > max)
+			max = time;
+	}
+
+	unsigned count;
+	sf::Time total;
+	sf::Time max;
+};
+
+static bool openAndShow(sfe::Movie& movie, const std::string& clip, OpenTimes& times)
+{
+	sf::Clock timer;
+
+	if (!movie.openFromFile(clip))
+	{
+		std::cerr << "Could not open " << clip << std::endl;
+		return false;
+	}
+
+	movie.getCurrentFrame();
+	times.add(timer.getElapsedTime());
+	return true;
+}
+
+static void printTimes(const std::string& mode, const OpenTimes& times)
+{
+	float average = times.count ? times.total.asMicroseconds() / 1000.f / times.count : 0;
+
+	std::cout << std::setw(16) << std::left << mode << std::right
+			  << std::setw(8) << times.count
+			  << std::setw(10) << std::fixed << std::setprecision(2) << average << "ms"
+			  << std::setw(10) << times.max.asMicroseconds() / 1000.f << "ms" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: " << std::string(argv[0]) << " rounds clip_path..." << std::endl;
+		return 1;
+	}
+
+	unsigned rounds = std::max(1, std::atoi(argv[1]));
+	std::vector<std::string> clips(argv + 2, argv + argc);
+	OpenTimes freshTimes;
+	OpenTimes reusedTimes;
+
+	// Open everything once so that both modes read the clips from the file cache
+	for (unsigned i = 0; i < clips.size(); i++)
+	{
+		sfe::Movie movie;
+		OpenTimes warmup;
+
+		if (!openAndShow(movie, clips[i], warmup))
+			return 1;
+	}
+
+	for (unsigned round = 0; round < rounds; round++)
+	{
+		for (unsigned i = 0; i < clips.size(); i++)
+		{
+			sfe::Movie movie;
+			openAndShow(movie, clips[i], freshTimes);
+		}
+	}
+
+	sfe::Movie reused;
+
+	for (unsigned round = 0; round < rounds; round++)
+	{
+		for (unsigned i = 0; i < clips.size(); i++)
+			openAndShow(reused, clips[i], reusedTimes);
+	}
+
+	std::cout << std::setw(16) << std::left << "mode" << std::right
+			  << std::setw(8) << "opens"
+			  << std::setw(12) << "avg"
+			  << std::setw(12) << "max" << std::endl;
+
+	printTimes("new Movie", freshTimes);
+	printTimes("reused Movie", reusedTimes);
+
+	return 0;
+}
@@ -0,0 +1,149 @@
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include "ProcessStats.hpp"
+
+/*
+ * Sustained frame rate of the reverse playback, compared to the forward one.
+ *
+ * Each clip is played forward then backward from its end, for the given
+ * duration at most, while a simulated render loop running at 60 Hz fetches
+ * the current frame (texture upload included) without displaying any window.
+ *
+ * Each row reports the frames displayed per second, the frames dropped
+ * because the playback was late, the peak resident memory, the peak thread
+ * count and the CPU usage of the whole process (100% = one core). The
+ * reverse decoding cost mostly depends on the keyframe interval: clips with
+ * several keyframe intervals can be generated with generate_clips.sh.
+ */
+
+struct PlaybackResult {
+	float displayedRate;
+	sf::Uint64 displayedFrames;
+	sf::Uint64 droppedFrames;
+	unsigned long peakResidentKB;
+	unsigned peakThreads;
+	double cpuSeconds;
+	sf::Time elapsed;
+};
+
+static bool runPlayback(const std::string& clip, bool reverse, sf::Time duration, PlaybackResult& result)
+{
+	const sf::Time tickTime = sf::seconds(1.f / 60);
+	sfe::Movie movie;
+
+	if (!movie.openFromFile(clip))
+	{
+		std::cerr << "Could not open " << clip << std::endl;
+		return false;
+	}
+
+	movie.setReversePlayback(reverse);
+
+	ProcessStats before = ProcessStats::current();
+	sf::Clock timer;
+
+	result.peakResidentKB = before.residentKB;
+	result.peakThreads = before.threadCount;
+
+	movie.play();
+
+	while (timer.getElapsedTime() < duration && movie.getStatus() == sfe::Movie::Playing)
+	{
+		sf::Clock tickTimer;
+		movie.getCurrentFrame();
+
+		ProcessStats now = ProcessStats::current();
+		if (now.residentKB > result.peakResidentKB)
+			result.peakResidentKB = now.residentKB;
+		if (now.threadCount > result.peakThreads)
+			result.peakThreads = now.threadCount;
+
+		sf::Time work = tickTimer.getElapsedTime();
+
+		if (work < tickTime)
+			sf::sleep(tickTime - work);
+	}
+
+	result.elapsed = timer.getElapsedTime();
+	result.cpuSeconds = ProcessStats::current().cpuSeconds - before.cpuSeconds;
+
+	sfe::Movie::Statistics stats = movie.getStatistics();
+	result.displayedFrames = stats.displayedFrames;
+	result.droppedFrames = stats.droppedFrames;
+	result.displayedRate = stats.displayedFrames / result.elapsed.asSeconds();
+
+	return true;
+}
+
+static void printResult(const std::string& clip, const char *direction, float framerate, const PlaybackResult& r)
+{
+	std::cout << std::setw(30) << std::left << clip << std::right
+			  << std::setw(9) << direction
+			  << std::setw(8) << std::fixed << std::setprecision(1) << framerate
+			  << std::setw(10) << r.displayedRate
+			  << std::setw(7) << r.droppedFrames << "/" << std::setw(6) << std::left << (r.displayedFrames + r.droppedFrames) << std::right
+			  << std::setw(10) << r.peakResidentKB / 1024 << "MB"
+			  << std::setw(9) << r.peakThreads
+			  << std::setw(7) << std::setprecision(0) << 100 * r.cpuSeconds / r.elapsed.asSeconds() << "%"
+			  << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << std::string(argv[0]) << " [--seconds N] clip_path..." << std::endl;
+		std::cout << "Each clip is played for 10 seconds by default in each direction" << std::endl;
+		return 1;
+	}
+
+	sf::Time duration = sf::seconds(10);
+	std::vector<std::string> clips;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == std::strcmp(argv[i], "--seconds") && i + 1 < argc)
+			duration = sf::seconds(std::atof(argv[++i]));
+		else
+			clips.push_back(argv[i]);
+	}
+
+	std::cout << std::setw(30) << std::left << "clip" << std::right
+			  << std::setw(9) << "dir"
+			  << std::setw(8) << "fps"
+			  << std::setw(10) << "shown/s"
+			  << std::setw(14) << "dropped"
+			  << std::setw(12) << "peak RSS"
+			  << std::setw(9) << "threads"
+			  << std::setw(8) << "CPU" << std::endl;
+
+	for (unsigned i = 0; i < clips.size(); i++)
+	{
+		PlaybackResult forward;
+		PlaybackResult backward;
+		float framerate = 0;
+
+		{
+			sfe::Movie movie;
+			if (movie.openFromFile(clips[i]))
+				framerate = movie.getFramerate();
+		}
+
+		if (!runPlayback(clips[i], false, duration, forward) ||
+			!runPlayback(clips[i], true, duration, backward))
+		{
+			return 1;
+		}
+
+		printResult(clips[i], "forward", framerate, forward);
+		printResult(clips[i], "reverse", framerate, backward);
+	}
+
+	return 0;
+}
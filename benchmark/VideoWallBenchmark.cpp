@@ -0,0 +1,206 @@
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include "ProcessStats.hpp"
+
+/*
+ * Video wall simulation: answers "how many tiles of this clip fit on this box".
+ *
+ * For each tile count, the given clip is opened that many times and all the
+ * instances are played in real time while a simulated render loop running at
+ * 60 Hz fetches the current frame of every movie (texture upload included),
+ * without displaying any window.
+ *
+ * Each row reports the video frames dropped by the movies because they were
+ * late, the average and worst per-movie decoding + conversion latency, the
+ * render ticks whose work didn't fit in the 60 Hz budget, the cost of fetching
+ * one movie frame, the peak resident memory, the peak thread count and the CPU
+ * usage of the whole process (100% = one core).
+ *
+ * Test clips can be generated with generate_clips.sh.
+ */
+
+struct WallResult {
+	unsigned tiles;
+	unsigned ticks;
+	unsigned missedTicks;
+	sf::Uint64 decodedFrames;
+	sf::Uint64 droppedFrames;
+	sf::Time averageLatency;
+	sf::Time maxLatency;
+	sf::Time totalFetchTime;
+	sf::Time maxFetchTime;
+	unsigned long peakResidentKB;
+	unsigned peakThreads;
+	double cpuSeconds;
+	sf::Time elapsed;
+};
+
+static bool runWall(const std::string& clip, unsigned tiles, sf::Time duration, WallResult& result)
+{
+	const sf::Time tickTime = sf::seconds(1.f / 60);
+	std::vector<sfe::Movie *> movies;
+	bool success = true;
+
+	for (unsigned i = 0; success && i < tiles; i++)
+	{
+		sfe::Movie *movie = new sfe::Movie;
+
+		if (movie->openFromFile(clip))
+			movies.push_back(movie);
+		else
+		{
+			delete movie;
+			success = false;
+		}
+	}
+
+	if (success)
+	{
+		ProcessStats before = ProcessStats::current();
+		sf::Clock timer;
+
+		result.tiles = tiles;
+		result.ticks = 0;
+		result.missedTicks = 0;
+		result.totalFetchTime = sf::Time::Zero;
+		result.maxFetchTime = sf::Time::Zero;
+		result.peakResidentKB = before.residentKB;
+		result.peakThreads = before.threadCount;
+
+		for (unsigned i = 0; i < movies.size(); i++)
+			movies[i]->play();
+
+		while (timer.getElapsedTime() < duration)
+		{
+			sf::Clock tickTimer;
+
+			for (unsigned i = 0; i < movies.size(); i++)
+			{
+				sf::Clock fetchTimer;
+				movies[i]->getCurrentFrame();
+				sf::Time fetchTime = fetchTimer.getElapsedTime();
+
+				result.totalFetchTime += fetchTime;
+				if (fetchTime > result.maxFetchTime)
+					result.maxFetchTime = fetchTime;
+			}
+
+			ProcessStats now = ProcessStats::current();
+			if (now.residentKB > result.peakResidentKB)
+				result.peakResidentKB = now.residentKB;
+			if (now.threadCount > result.peakThreads)
+				result.peakThreads = now.threadCount;
+
+			sf::Time work = tickTimer.getElapsedTime();
+			result.ticks++;
+
+			if (work > tickTime)
+				result.missedTicks++;
+			else
+				sf::sleep(tickTime - work);
+		}
+
+		result.elapsed = timer.getElapsedTime();
+		result.cpuSeconds = ProcessStats::current().cpuSeconds - before.cpuSeconds;
+		result.decodedFrames = 0;
+		result.droppedFrames = 0;
+		result.averageLatency = sf::Time::Zero;
+		result.maxLatency = sf::Time::Zero;
+
+		for (unsigned i = 0; i < movies.size(); i++)
+		{
+			sfe::Movie::Statistics stats = movies[i]->getStatistics();
+			sf::Time latency = stats.decodingTimes.getAverage() + stats.conversionTimes.getAverage();
+
+			result.decodedFrames += stats.decodedFrames;
+			result.droppedFrames += stats.droppedFrames;
+			result.averageLatency += latency / (float)movies.size();
+
+			if (latency > result.maxLatency)
+				result.maxLatency = latency;
+		}
+	}
+	else
+	{
+		std::cerr << "Could not open " << clip << " (tile " << movies.size() + 1 << ")" << std::endl;
+	}
+
+	for (unsigned i = 0; i < movies.size(); i++)
+		delete movies[i];
+
+	return success;
+}
+
+int main(int argc, const char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << std::string(argv[0]) << " clip_path [seconds=10] [--pool] [tile_count...]" << std::endl;
+		std::cout << "Default tile counts are 1 4 16 64" << std::endl;
+		return 1;
+	}
+
+	std::string clip = std::string(argv[1]);
+	sf::Time duration = sf::seconds(10);
+	std::vector<unsigned> tileCounts;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (0 == std::strcmp(argv[i], "--pool"))
+			sfe::Movie::useSharedDecodePool(true);
+		else if (i == 2)
+			duration = sf::seconds(std::atof(argv[i]));
+		else
+			tileCounts.push_back(std::atoi(argv[i]));
+	}
+
+	if (tileCounts.empty())
+	{
+		tileCounts.push_back(1);
+		tileCounts.push_back(4);
+		tileCounts.push_back(16);
+		tileCounts.push_back(64);
+	}
+
+	std::cout << std::setw(6) << "tiles"
+			  << std::setw(14) << "dropped"
+			  << std::setw(12) << "decode avg"
+			  << std::setw(12) << "decode max"
+			  << std::setw(11) << "missed"
+			  << std::setw(12) << "fetch avg"
+			  << std::setw(12) << "fetch max"
+			  << std::setw(12) << "peak RSS"
+			  << std::setw(9) << "threads"
+			  << std::setw(8) << "CPU" << std::endl;
+
+	for (unsigned i = 0; i < tileCounts.size(); i++)
+	{
+		WallResult r;
+
+		if (!runWall(clip, tileCounts[i], duration, r))
+			return 1;
+
+		sf::Int64 fetchCount = (sf::Int64)r.ticks * r.tiles;
+		float avgFetchMs = fetchCount ? r.totalFetchTime.asMicroseconds() / 1000.f / fetchCount : 0;
+
+		std::cout << std::setw(6) << r.tiles
+				  << std::setw(7) << r.droppedFrames << "/" << std::setw(6) << std::left << (r.decodedFrames + r.droppedFrames) << std::right
+				  << std::setw(10) << std::fixed << std::setprecision(2) << r.averageLatency.asMicroseconds() / 1000.f << "ms"
+				  << std::setw(10) << r.maxLatency.asMicroseconds() / 1000.f << "ms"
+				  << std::setw(6) << r.missedTicks << "/" << std::setw(4) << std::left << r.ticks << std::right
+				  << std::setw(10) << avgFetchMs << "ms"
+				  << std::setw(10) << r.maxFetchTime.asMicroseconds() / 1000.f << "ms"
+				  << std::setw(10) << r.peakResidentKB / 1024 << "MB"
+				  << std::setw(9) << r.peakThreads
+				  << std::setw(7) << std::setprecision(0) << 100 * r.cpuSeconds / r.elapsed.asSeconds() << "%"
+				  << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Generates the synthetic test clips used by the benchmarks.
+# Requires an ffmpeg command line tool built with libvpx and libvorbis,
+# the clips use the VP8 and Vorbis decoders enabled in the builtin FFmpeg.
+#
+# Usage: generate_clips.sh [output_dir] [seconds]
+
+output_dir="${1:-.}"
+duration="${2:-30}"
+
+function check_err()
+{
+	if [ $? -ne 0 ]
+	  then
+	    echo "*** an error occured, aborting.";
+	    exit 1;
+	fi
+}
+
+function generate_clip()
+{
+	name="$1"
+	size="$2"
+	gop="${3:-60}"
+	
+	echo "Generating ${output_dir}/${name}.webm (${size}, ${duration}s, keyframe every ${gop} frames)..."
+	ffmpeg -y -loglevel error \
+		-f lavfi -i "testsrc=size=${size}:rate=30" \
+		-f lavfi -i "sine=frequency=440:sample_rate=44100" \
+		-t "${duration}" -c:v libvpx -b:v 2M -g "${gop}" -keyint_min "${gop}" -c:a libvorbis \
+		"${output_dir}/${name}.webm"
+	check_err
+}
+
+mkdir -p "${output_dir}"
+generate_clip "test_360p" "640x360"
+generate_clip "test_720p" "1280x720"
+generate_clip "test_1080p" "1920x1080"
+
+# Common keyframe intervals, for the reverse playback benchmark
+generate_clip "test_720p_gop15" "1280x720" 15
+generate_clip "test_720p_gop250" "1280x720" 250
@@ -29,39 +29,95 @@
 #include <SFML/Graphics/Drawable.hpp>
 #include <SFML/Graphics/Transformable.hpp>
 #include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
 #include <SFML/System/Clock.hpp>
 #include <SFML/System/Mutex.hpp>
 #include <SFML/System/Thread.hpp>
 #include <SFML/Config.hpp>
+#include <sfeMovie/Config.hpp>
+#include <sfeMovie/VideoFrame.hpp>
 #include <string>
+#include <vector>
+#include <cstddef>
 
 
-////////////////////////////////////////////////////////////
-// Define portable import / export macros
-////////////////////////////////////////////////////////////
-#if defined(SFML_SYSTEM_WINDOWS) && defined(_MSC_VER)
-    #ifdef SFE_EXPORTS
-        // From DLL side, we must export
-        #define SFE_API __declspec(dllexport)
-    #else
-        // From client application side, we must import
-        #define SFE_API __declspec(dllimport)
-    #endif
-
-    // For Visual C++ compilers, we also need to turn off this annoying C4251 warning.
-    // You can read lots ot different things about it, but the point is the code will
-    // just work fine, and so the simplest way to get rid of this warning is to disable it
-    #ifdef _MSC_VER
-        #pragma warning(disable : 4251)
-    #endif
-#else
-	#define SFE_API
-#endif
-
 namespace sfe {
 	class Movie_audio;
 	class Movie_video;
 	class Condition;
+	class SideDemuxer;
+	
+	/** @brief Distribution of durations, used by Movie::Statistics
+	 *
+	 * Samples are counted in buckets whose upper bounds double from one
+	 * bucket to the next, starting at 250 microseconds. The last bucket
+	 * holds all the samples longer than the previous bounds.
+	 */
+	struct TimeHistogram
+	{
+		enum
+		{
+			BucketCount = 12 //!< 0.25ms, 0.5ms, 1ms... 256ms, and longer
+		};
+		
+		TimeHistogram(void) :
+		count(0),
+		total(sf::Time::Zero),
+		min(sf::Time::Zero),
+		max(sf::Time::Zero),
+		last(sf::Time::Zero)
+		{
+			for (unsigned i = 0; i < BucketCount; i++)
+				buckets[i] = 0;
+		}
+		
+		/** @brief Returns the exclusive upper bound of the given bucket
+		 *
+		 * The last bucket has no upper bound and its returned bound is the one
+		 * of the previous bucket.
+		 */
+		static sf::Time getBucketLimit(unsigned bucket)
+		{
+			if (bucket >= BucketCount - 1)
+				bucket = BucketCount - 2;
+			return sf::microseconds(250 << bucket);
+		}
+		
+		/** @brief Adds one sample to the histogram
+		 */
+		void add(sf::Time sample)
+		{
+			unsigned bucket = 0;
+			while (bucket < BucketCount - 1 && sample >= getBucketLimit(bucket))
+				bucket++;
+			
+			buckets[bucket]++;
+			
+			if (count == 0 || sample < min)
+				min = sample;
+			if (count == 0 || sample > max)
+				max = sample;
+			
+			count++;
+			total += sample;
+			last = sample;
+		}
+		
+		/** @brief Returns the mean of the samples, or zero if there is no sample
+		 */
+		sf::Time getAverage(void) const
+		{
+			return count ? sf::microseconds(total.asMicroseconds() / (sf::Int64)count) : sf::Time::Zero;
+		}
+		
+		sf::Uint64 buckets[BucketCount]; //!< Amount of samples in each bucket
+		sf::Uint64 count; //!< Total amount of samples
+		sf::Time total;   //!< Sum of all the samples
+		sf::Time min;     //!< Shortest sample
+		sf::Time max;     //!< Longest sample
+		sf::Time last;    //!< Most recent sample
+	};
+	
 	
 	class SFE_API Movie : public sf::Drawable, public sf::Transformable {
 		friend class Movie_audio;
@@ -77,6 +133,48 @@ namespace sfe {
 		};
 		
 		
+		/** @brief Snapshot of the playback statistics, see getStatistics()
+		 *
+		 * Frame counters and time histograms are accumulated since the movie
+		 * has been opened, queue depths are the current ones.
+		 */
+		struct Statistics
+		{
+			Statistics(void);
+			
+			sf::Uint64 decodedFrames;       //!< Video frames decoded and converted to RGBA
+			sf::Uint64 displayedFrames;     //!< Video frames uploaded to the movie texture
+			sf::Uint64 droppedFrames;       //!< Video frames not converted because the playback was late
+			sf::Uint64 lateFrames;          //!< Video frames displayed after their presentation time was over
+			TimeHistogram decodingTimes;    //!< Time spent decoding each video packet
+			TimeHistogram conversionTimes;  //!< Time spent converting each video frame to RGBA
+			sf::Uint64 videoQueuedBytes;    //!< Size of the video packets waiting for being decoded
+			sf::Time videoQueuedDuration;   //!< Duration of the video packets waiting for being decoded
+			sf::Uint64 audioQueuedBytes;    //!< Size of the audio packets waiting for being decoded
+			sf::Time audioQueuedDuration;   //!< Duration of the audio packets waiting for being decoded
+			sf::Uint64 bytesRead;           //!< Size of all the packets read from the movie file
+			sf::Uint64 audioUnderruns;      //!< Times the sound card played everything it was given before getting more sound
+			sf::Uint64 audioPrematureEnds;  //!< Times the audio stream ran out of data and ended before the end of the file
+			sf::Time audioVideoOffset;      //!< Video position minus audio position (positive when video is ahead)
+		};
+		
+		
+		/** @brief Description of a video or audio track, see getVideoTracks() and getAudioTracks()
+		 */
+		struct TrackInfo
+		{
+			TrackInfo(void);
+			
+			std::string language;           //!< Language code (usually ISO 639-2), empty if unknown
+			std::string title;              //!< Name given to the track by the file, empty if none
+			std::string codec;              //!< Short name of the codec
+			sf::Vector2i size;              //!< Picture size, for video tracks
+			unsigned channelCount;          //!< Amount of channels, for audio tracks
+			unsigned sampleRate;            //!< Samples per second, for audio tracks
+			bool isDefault;                 //!< Whether the file marks the track as a default one
+		};
+		
+		
 		/** @brief Default constructor
 		 */
 		Movie(void);
@@ -109,6 +207,25 @@ namespace sfe {
 		void play(void);
 		
 		
+		/** @brief Prepares the playback to start instantly at the given position
+		 *
+		 * The movie is seeked to @a position, the image at this position is decoded
+		 * and made ready for display, @a videoPrefill of video data is read ahead and
+		 * @a audioPrefill of sound is decoded, so that the next call to play() shows
+		 * the first image and starts the sound without any delay.
+		 *
+		 * The movie must be stopped. Calling stop() afterwards cancels the preroll.
+		 *
+		 * @param position the position where the playback will start
+		 * @param videoPrefill the duration of video data to read ahead
+		 * @param audioPrefill the duration of sound to decode ahead
+		 * @return true on success, false otherwise
+		 */
+		bool preroll(sf::Time position,
+					 sf::Time videoPrefill = sf::milliseconds(500),
+					 sf::Time audioPrefill = sf::milliseconds(500));
+		
+		
 		/** @brief Pauses the movie playback
 		 *
 		 * If the movie playback is already paused,
@@ -160,9 +277,105 @@ namespace sfe {
 		sf::Time getDuration(void) const;
 		
 		
+		/** @brief Returns the video tracks of the opened file
+		 *
+		 * Files may hold several video tracks (eg. camera angles). The position of a
+		 * track in the returned list is the index to give to selectVideoTrack().
+		 *
+		 * @return the video tracks, empty if no file is opened
+		 */
+		std::vector<TrackInfo> getVideoTracks(void) const;
+		
+		
+		/** @brief Returns the audio tracks of the opened file
+		 *
+		 * Files may hold several audio tracks (eg. languages or commentaries). The position
+		 * of a track in the returned list is the index to give to selectAudioTrack().
+		 *
+		 * @return the audio tracks, empty if no file is opened
+		 */
+		std::vector<TrackInfo> getAudioTracks(void) const;
+		
+		
+		/** @brief Chooses the video track to play
+		 *
+		 * By default the track FFmpeg considers the best one is played. The packets of
+		 * the tracks that are not selected are skipped while reading the file, thus
+		 * they cost almost nothing.
+		 *
+		 * The movie must be stopped. Selecting a track goes back to the beginning
+		 * of the movie.
+		 *
+		 * @param index the index of the track in getVideoTracks()
+		 * @return true if the track is ready to be played, false otherwise
+		 */
+		bool selectVideoTrack(unsigned index);
+		
+		
+		/** @brief Chooses the audio track to play
+		 *
+		 * @param index the index of the track in getAudioTracks()
+		 * @return true if the track is ready to be played, false otherwise
+		 * @see selectVideoTrack
+		 */
+		bool selectAudioTrack(unsigned index);
+		
+		
+		/** @brief Returns the index in getVideoTracks() of the played video track, -1 if none
+		 */
+		int getSelectedVideoTrack(void) const;
+		
+		
+		/** @brief Returns the index in getAudioTracks() of the played audio track, -1 if none
+		 */
+		int getSelectedAudioTrack(void) const;
+		
+		
+		/** @brief Chooses whether the video of the file is played (default is true)
+		 *
+		 * When disabled, the video decoder is not opened, its packets are skipped while
+		 * reading the file and no video decoding thread is started: playing a movie only
+		 * for its soundtrack costs no more than playing a sound file. getCurrentFrame()
+		 * then gives an empty texture.
+		 *
+		 * The change applies immediately if the movie is stopped (and goes back to
+		 * the beginning), otherwise to the next opened file.
+		 *
+		 * @param flag true to play the video, false otherwise
+		 */
+		void setVideoEnabled(bool flag);
+		
+		
+		/** @brief Returns whether the video of the file is played
+		 */
+		bool isVideoEnabled(void) const;
+		
+		
+		/** @brief Chooses whether the audio of the file is played (default is true)
+		 *
+		 * When disabled, the audio decoder is not opened, its packets are skipped while
+		 * reading the file and no sound stream is played, which is cheaper than setting
+		 * the volume to 0 for muted movies.
+		 *
+		 * The change applies immediately if the movie is stopped (and goes back to
+		 * the beginning), otherwise to the next opened file.
+		 *
+		 * @param flag true to play the audio, false otherwise
+		 */
+		void setAudioEnabled(bool flag);
+		
+		
+		/** @brief Returns whether the audio of the file is played
+		 */
+		bool isAudioEnabled(void) const;
+		
+		
 		/** @brief Returns the size (width, height) of the movie
+		 *
+		 * When a preview level is set, this is the reduced size of the decoded frames.
 		 *
 		 * @return the size of the movie
+		 * @see setPreviewLevel
 		 */
 		sf::Vector2i getSize(void) const;
 		
@@ -221,6 +434,9 @@ namespace sfe {
 		
 		
 		/** @brief Returns the current playing position in the movie
+		 *
+		 * When looping, this is the position in the movie rather than the time
+		 * elapsed since the playback started.
 		 *
 		 * @return the playing position
 		 */
@@ -240,8 +456,338 @@ namespace sfe {
 		const sf::Texture& getCurrentFrame(void) const;
 		
 		
-		//void SetLoop(bool Loop);
-		//bool GetLoop() const;
+		/** @brief Returns the time left before getCurrentFrame() gives a new image
+		 *
+		 * Render loops that don't wait for the vertical synchronization can sleep for
+		 * this duration instead of polling the movie, then call getCurrentFrame() or
+		 * draw the movie. This follows the same rule as the texture update, thus waking
+		 * up at the returned time always finds the frame due, provided the decoding is
+		 * not late. While it is late, sf::Time::Zero is returned.
+		 *
+		 * @return the delay before the next frame, or a negative time if no frame is
+		 * expected (the movie is not playing or has no video)
+		 */
+		sf::Time getNextFrameTime(void) const;
+		
+		
+		/** @brief Returns the time left before any of the given movies has a new image
+		 *
+		 * Movies that don't expect any frame are ignored.
+		 *
+		 * @param movies the movies being displayed
+		 * @return the shortest delay before the next frame, or a negative time if none
+		 * of the movies expects a frame
+		 * @see getNextFrameTime()
+		 */
+		static sf::Time getNextFrameTime(const std::vector<Movie *>& movies);
+		
+		
+		/** @brief Decodes the next video frame as fast as possible
+		 *
+		 * This is meant for offline processing: the frames are decoded in the calling
+		 * thread, regardless of the playback clock, and none of them is skipped.
+		 * The first call after the movie has been opened or stopped starts from the
+		 * beginning of the movie. The audio track is ignored meanwhile.
+		 *
+		 * The movie must be stopped. Calling play() afterwards starts the playback
+		 * from the beginning of the movie.
+		 *
+		 * @param frame receives the decoded frame, which can be kept as long as needed
+		 * @return true if a frame was decoded, false at the end of the movie or on error
+		 */
+		bool nextFrame(VideoFrame& frame);
+		
+		
+		/** @brief Chooses the playback direction (default is forward)
+		 *
+		 * When reverse playback is enabled, play() shows the video backward from the
+		 * displayed frame, or from the end of the movie when it is stopped at the
+		 * beginning, down to the first frame where the playback stops. The sound is
+		 * not played meanwhile and the loop settings are ignored.
+		 *
+		 * The frames are decoded ahead on worker threads, each with its own reader of
+		 * the file, one group of pictures at a time. Groups of pictures longer than
+		 * 2 seconds are decoded several times, thus such movies need much more
+		 * processing power backward than forward.
+		 *
+		 * Changing the direction of a playing movie goes on from the displayed frame.
+		 * A paused movie is stopped on its displayed frame, where play() starts from.
+		 *
+		 * @param flag true to play backward, false to play forward
+		 */
+		void setReversePlayback(bool flag);
+		
+		
+		/** @brief Returns whether play() plays the movie backward
+		 *
+		 * @see setReversePlayback
+		 */
+		bool isReversePlayback(void) const;
+		
+		
+		/** @brief Sets the playback speed (default is 1)
+		 *
+		 * The speed is clamped to the [0.25, 8] range and can be changed while playing.
+		 * The sound keeps its pitch: it is time-stretched by overlapping short pieces
+		 * of it, which gives audible artefacts at the extreme speeds.
+		 *
+		 * Above 2x the video decoder skips the frames that are not used as references,
+		 * above 4x it only decodes the keyframes. It skips even more frames while the
+		 * decoding can't keep up with the wanted speed.
+		 *
+		 * @param speed the playback speed, 1 for the normal speed
+		 */
+		void setPlaybackSpeed(float speed);
+		
+		
+		/** @brief Returns the playback speed
+		 *
+		 * @see setPlaybackSpeed
+		 */
+		float getPlaybackSpeed(void) const;
+		
+		
+		/** @brief Displays the video frame following the current one
+		 *
+		 * The frames are decoded in the calling thread. A paused movie is stopped
+		 * first, keeping its current image. Calling play() afterwards starts the
+		 * playback from the displayed frame, unless stop() is called in between.
+		 *
+		 * @return true if a frame was displayed, false at the end of the movie, on error
+		 * or if the movie is playing
+		 * @see stepBackward
+		 */
+		bool stepForward(void);
+		
+		
+		/** @brief Displays the video frame preceding the current one
+		 *
+		 * Going backward requires decoding from the previous keyframe. All the
+		 * frames decoded meanwhile are kept, thus the following steps in either
+		 * direction are served without decoding the group of pictures again, as
+		 * long as they fit in the step cache (see setStepCacheSize()).
+		 *
+		 * @return true if a frame was displayed, false at the beginning of the movie,
+		 * on error or if the movie is playing
+		 * @see stepForward
+		 */
+		bool stepBackward(void);
+		
+		
+		/** @brief Sets the maximum amount of memory used by the frames kept for stepping
+		 *
+		 * The frames are kept in RGBA at the displayed size, thus the default of 128 MB
+		 * holds about 16 frames of a 1080p movie. The frames farthest from the current
+		 * one are dropped first, the current and adjacent frames are always kept.
+		 *
+		 * @param bytes the maximum size of the kept frames
+		 */
+		void setStepCacheSize(std::size_t bytes);
+		
+		
+		/** @brief Returns the maximum amount of memory used by the frames kept for stepping
+		 *
+		 * @see setStepCacheSize
+		 */
+		std::size_t getStepCacheSize(void) const;
+		
+		
+		/** @brief Quickly displays the keyframe at or before the given position
+		 *
+		 * Meant for scrub bars: only the keyframe is decoded instead of the whole
+		 * group of pictures leading to the position, and it is converted at a reduced
+		 * size. When the keyframe is already displayed, nothing is decoded at all, thus
+		 * dragging within a group of pictures costs almost nothing.
+		 *
+		 * A playing or paused movie is stopped first. While scrubbing, draw() stretches
+		 * the reduced image to the movie size and getCurrentFrame() returns the reduced
+		 * image. Stepping or calling play() leaves the scrubbing: play() starts from the
+		 * displayed keyframe, unless stop() is called in between.
+		 *
+		 * @param position the wanted position in the movie
+		 * @param previewLevel amount of times the displayed size is halved
+		 * @return true if a keyframe was displayed, false on error
+		 */
+		bool scrub(sf::Time position, unsigned previewLevel = 1);
+		
+		
+		/** @brief Extracts one image of the movie, for thumbnails
+		 *
+		 * The movie is seeked to the keyframe preceding @a time, only this keyframe
+		 * is decoded and it is directly scaled to @a size. This is done in the calling
+		 * thread, without decoding audio nor using any texture.
+		 *
+		 * The movie must be stopped. Calling play() or nextFrame() afterwards starts
+		 * from the beginning of the movie.
+		 *
+		 * @param time the position of the wanted image
+		 * @param size the size of the extracted image; when one dimension is 0 it is
+		 * computed to keep the movie ratio, when both are 0 the movie size is used
+		 * @param image receives the RGBA image
+		 * @return true on success, false otherwise
+		 */
+		bool extractFrame(sf::Time time, sf::Vector2u size, sf::Image& image);
+		
+		
+		/** @brief Extracts one image of a movie file, for thumbnails
+		 *
+		 * This is the fastest way of getting a thumbnail of a file that is not
+		 * going to be played: only the video stream is opened.
+		 *
+		 * @param filename the path to the movie file
+		 * @see extractFrame(sf::Time, sf::Vector2u, sf::Image&)
+		 */
+		static bool extractFrame(const std::string& filename, sf::Time time, sf::Vector2u size, sf::Image& image);
+		
+		
+		/** @brief Extracts several images of a movie file, for thumbnails
+		 *
+		 * The file and its video decoder are opened only once for all the images.
+		 * Images that could not be extracted are left empty.
+		 *
+		 * @param filename the path to the movie file
+		 * @param times the positions of the wanted images
+		 * @param size the size of the extracted images, see extractFrame(sf::Time, sf::Vector2u, sf::Image&)
+		 * @param images receives one RGBA image per position
+		 * @return true if at least one image could be extracted, false otherwise
+		 */
+		static bool extractFrames(const std::string& filename, const std::vector<sf::Time>& times,
+								  sf::Vector2u size, std::vector<sf::Image>& images);
+		
+		
+		/** @brief Extracts images evenly spaced over the duration of a movie file
+		 *
+		 * Each image is taken from the middle of one of the @a count equal parts of the movie.
+		 *
+		 * @see extractFrames(const std::string&, const std::vector<sf::Time>&, sf::Vector2u, std::vector<sf::Image>&)
+		 */
+		static bool extractFrames(const std::string& filename, unsigned count,
+								  sf::Vector2u size, std::vector<sf::Image>& images);
+		
+		
+		/** @brief Sets an object that receives every decoded video frame
+		 *
+		 * The sink is given the decoded pictures in their native pixel format
+		 * (no RGBA conversion), from the decoding thread. The frames can be
+		 * copied and kept without copying their pixels.
+		 *
+		 * When @a renderFrames is false, the frames are neither converted nor uploaded
+		 * to the texture, which is then left unchanged: the movie is only decoded
+		 * for the sink, at the playback speed.
+		 *
+		 * Once this method returns, the previous sink is not called anymore.
+		 * The sink is kept when opening another movie.
+		 *
+		 * @param sink the object receiving the frames, or NULL to remove the current one
+		 * @param renderFrames whether the frames should still be displayed by this movie
+		 */
+		void setFrameSink(FrameSink *sink, bool renderFrames = true);
+		
+		
+		/** @brief Returns the playback statistics of the movie
+		 *
+		 * This is meant for monitoring the playback quality (dropped frames,
+		 * decoding costs, buffering state) and can be called at any time from any thread.
+		 *
+		 * @return a snapshot of the current statistics
+		 */
+		Statistics getStatistics(void) const;
+		
+		
+		/** @brief Sets whether the movie restarts when reaching its end (default is false)
+		 *
+		 * Looping is done while reading the file, ahead of the playback: the decoding
+		 * queues stay filled across the loop point thus there is no gap in the image
+		 * nor the sound.
+		 *
+		 * @param flag true to loop, false otherwise
+		 * @see setLoopRange
+		 */
+		void setLoop(bool flag);
+		
+		
+		/** @brief Returns whether the movie restarts when reaching its end
+		 *
+		 * @return true if the movie loops, false otherwise
+		 */
+		bool getLoop(void) const;
+		
+		
+		/** @brief Restricts looping to a part of the movie
+		 *
+		 * Once the playback reaches @a end, it goes on from @a start. The movie is
+		 * played from the beginning (or from the preroll position) until @a end is reached
+		 * for the first time.
+		 *
+		 * Note that the range may be extended up to the previous keyframe for the start
+		 * and the next video packet for the end for codecs where frames are reordered.
+		 *
+		 * @param start the beginning of the looped part
+		 * @param end the end of the looped part, sf::Time::Zero for the end of the movie
+		 */
+		void setLoopRange(sf::Time start, sf::Time end = sf::Time::Zero);
+		
+		
+		/** @brief Returns the beginning of the looped part of the movie
+		 */
+		sf::Time getLoopStart(void) const;
+		
+		
+		/** @brief Returns the end of the looped part of the movie, or the duration of the movie
+		 */
+		sf::Time getLoopEnd(void) const;
+		
+		
+		/** @brief Decodes the video at a reduced resolution, for previews (default is 0)
+		 *
+		 * Each level halves the width and height of the video: level 1 gives half the
+		 * size, 2 a quarter and 3 an eighth, which cuts the decoding and conversion cost
+		 * by about 4, 16 and 64 times. Thus it is meant for small thumbnails such as
+		 * the ones of scrub bars or picture-in-picture tiles.
+		 *
+		 * Decoders that can decode at a lower resolution skip the unneeded details
+		 * themselves, for the others the frames are decoded at full resolution and
+		 * downscaled during the conversion to RGBA.
+		 *
+		 * The level is taken into account by the next openFromFile() call. getSize()
+		 * and the frames given to the sink then have the reduced size.
+		 *
+		 * @param level the amount of halvings, in range [0, 3]
+		 */
+		void setPreviewLevel(unsigned level);
+		
+		
+		/** @brief Returns the amount of times the video size is halved when decoding
+		 *
+		 * @see setPreviewLevel
+		 */
+		unsigned getPreviewLevel(void) const;
+		
+		
+		/** @brief Sets the maximum amount of memory used by the packets read ahead (default is 32 MB)
+		 *
+		 * The file is read in storage order, thus getting the next audio packet may require
+		 * queueing many video packets first, and the other way round. On badly interleaved
+		 * files this can grow to hundreds of megabytes.
+		 *
+		 * With a budget, the queue of a stream is considered full once it holds 3/4 of the
+		 * budget, and until it goes down to 1/4 of it. While one queue is full, the other
+		 * stream is read on its own through a second reader of the file, so that the full
+		 * queue doesn't grow any further. The packets read twice are dropped once the main
+		 * reader catches up.
+		 *
+		 * Looping movies always read through a single reader.
+		 *
+		 * @param bytes the maximum size of the queued packets, 0 for no limit
+		 */
+		void setDemuxMemoryBudget(std::size_t bytes);
+		
+		
+		/** @brief Returns the maximum amount of memory used by the packets read ahead
+		 *
+		 * @see setDemuxMemoryBudget
+		 */
+		std::size_t getDemuxMemoryBudget(void) const;
 		
 		
 		/** @brief Choose whether to print debug messages
@@ -253,8 +799,11 @@ namespace sfe {
 		 * (because the movie playback was late)
 		 *
 		 * Disabling the debug messages does not prevent sfe::Movie from
-		 * displaying the error messages.
-		 * The debug messages are always sent to the cerr output stream.
+		 * displaying the error and warning messages.
+		 * The messages are always sent to the cerr output stream. They are written
+		 * by a background thread so that enabling them doesn't slow down the playback.
+		 * Messages more verbose than the SFEMOVIE_LOG_LEVEL CMake option are not
+		 * compiled in sfeMovie at all.
 		 *
 		 * @param flag true to enable the debug messages outputting, false otherwise
 		 */
@@ -268,6 +817,77 @@ namespace sfe {
 		 */
 		static bool usesDebugMessages(void);
 		
+		
+		/** @brief Choose whether the video decoding should be done on a shared pool of threads
+		 *
+		 * By default each playing movie owns its own video decoding thread. When the shared
+		 * decode pool is enabled, the video decoding of all the movies is scheduled on a
+		 * single pool of worker threads sized to the amount of CPU cores, which greatly
+		 * reduces the thread count when many movies are played at the same time.
+		 *
+		 * The setting is taken into account by movies started with play() after this call.
+		 *
+		 * @param flag true to use the shared decode pool, false to use one thread per movie
+		 */
+		static void useSharedDecodePool(bool flag = true);
+		
+		
+		/** @brief Return whether the shared decode pool is enabled
+		 *
+		 * @return true if new playbacks decode their video on the shared pool, false otherwise
+		 * @see useSharedDecodePool
+		 */
+		static bool usesSharedDecodePool(void);
+		
+		
+		/** @brief Set the maximum amount of memory kept for reusing frame buffers
+		 *
+		 * The decoded pictures and RGBA frames of all the movies are allocated from a
+		 * process-wide pool: the buffers of closed movies or released frames are kept
+		 * and reused by the next movie with the same video format, so that opening
+		 * and closing many movies doesn't fragment the heap. The least recently used
+		 * buffers are freed when the pool exceeds its capacity. Buffers that are in
+		 * use don't count towards the capacity. The kept buffers are freed when the last
+		 * Movie is destroyed.
+		 *
+		 * The default capacity is 64 MB.
+		 *
+		 * @param bytes the maximum size of the unused buffers kept, 0 to free the buffers as soon as they are released
+		 */
+		static void setFrameBufferPoolCapacity(std::size_t bytes);
+		
+		
+		/** @brief Return the maximum amount of memory kept for reusing frame buffers
+		 *
+		 * @return the capacity in bytes
+		 * @see setFrameBufferPoolCapacity
+		 */
+		static std::size_t getFrameBufferPoolCapacity(void);
+		
+		
+		/** @brief Choose whether to record a timeline of the decoding activity
+		 *
+		 * When enabled, every thread involved in the playback of any movie records
+		 * the time spent reading packets, decoding, converting to RGBA, uploading
+		 * textures and waiting for the other threads. The timeline can then be
+		 * written with saveTrace().
+		 *
+		 * @param flag true to start recording, false to stop
+		 */
+		static void useTracing(bool flag = true);
+		
+		
+		/** @brief Writes the timeline recorded since the last save
+		 *
+		 * The file uses the Chrome trace event format (JSON), which can be opened
+		 * with chrome://tracing or https://ui.perfetto.dev
+		 *
+		 * @param filename the path of the file to write
+		 * @return true on success, false otherwise
+		 * @see useTracing
+		 */
+		static bool saveTrace(const std::string& filename);
+		
 	private:
 		
 #ifndef LIBAVCODEC_VERSION
@@ -278,6 +898,7 @@ namespace sfe {
 		typedef AVPacket *AVPacketRef;
 #endif
 		void internalStop(bool calledFromWatchThread);
+		void rewind(void);
 		void draw(sf::RenderTarget& Target, sf::RenderStates states) const;
 		
 		static void outputError(int err, const std::string& fallbackMessage = "");
@@ -288,14 +909,56 @@ namespace sfe {
 		void setEofReached(bool flag);
 		void setDuration(sf::Time duration);
 		bool readFrameAndQueue(void);
+		bool readStreamPacket(int streamID);
+		bool readSidePacket(int streamID);
+		bool isOtherQueueFull(int streamID);
+		bool isReadBySideDemuxer(AVPacketRef packet);
+		void resetSideReading(void);
+		void findTracks(void);
+		void discardUnselectedStreams(void);
+		void restartAfterTrackChange(void);
+		bool step(bool backward);
+		bool startReverse(void);
+		bool seekForStep(sf::Time position);
+		bool loopReadPosition(void);
+		sf::Time getPacketTime(AVPacketRef packet) const;
+		sf::Time getPlaybackClock(void) const;
 		bool saveFrame(AVPacketRef frame);
 		void starvation(void);
 		void watch(void);
 		
 		AVFormatContextRef m_avFormatCtx;
+		sf::Uint64 m_bytesRead;
+		mutable sf::Mutex m_statsMutex;
 		bool m_hasVideo;
 		bool m_hasAudio;
 		bool m_eofReached;
+		bool m_isDecodingOffline;	// Whether nextFrame() is being used instead of the playback
+		bool m_needsRewind;			// Whether the read position has been moved by extractFrame()
+		bool m_isStepping;			// Whether play() starts from the displayed frame (after stepping or a change of direction)
+		bool m_isReverse;			// See setReversePlayback()
+		bool m_isPlayingReverse;	// Whether the current playback is backward
+		sf::Time m_reverseStart;	// Position where the reverse playback started
+		bool m_loop;
+		sf::Time m_loopStart;
+		sf::Time m_loopEnd;			// Zero for the end of the file
+		mutable sf::Mutex m_loopMutex;// Written with m_readerMutex held too, thus the reading thread doesn't need it
+		bool m_isSkippingToLoopStart;// Whether the audio packets preceding m_loopStart are dropped after looping
+		unsigned m_packetsSinceLoop;// Packets queued since the last loop, to detect empty loop ranges
+		unsigned m_previewLevel;	// Amount of halvings of the decoded size, see setPreviewLevel()
+		std::size_t m_demuxBudget;	// Maximum size of the queued packets, 0 for no limit
+		bool m_isVideoQueueFull;	// Queue states, see isOtherQueueFull()
+		bool m_isAudioQueueFull;
+		sf::Int64 m_lastVideoDts;	// Decoding timestamps of the last queued packets
+		sf::Int64 m_lastAudioDts;
+		bool m_canUseSideDemuxer;	// False once opening the second reader failed for this file
+		SideDemuxer *m_sideDemuxer;	// Reads the starving stream while the other queue is full
+		std::vector<int> m_videoStreams;// Stream index of each video track
+		std::vector<int> m_audioStreams;
+		int m_videoTrack;			// Selected track in m_videoStreams, -1 if none
+		int m_audioTrack;
+		bool m_isVideoEnabled;		// Whether the selected tracks are decoded, see setVideoEnabled()
+		bool m_isAudioEnabled;
 		sf::Mutex m_stopMutex;
 		sf::Mutex m_readerMutex;
 		sf::Thread m_watchThread;
@@ -305,6 +968,8 @@ namespace sfe {
 		sf::Time m_duration;
 		sf::Clock m_overallTimer;
 		sf::Time m_progressAtPause;
+		float m_playbackSpeed;		// See setPlaybackSpeed(), scales the time of m_overallTimer
+		mutable sf::Mutex m_clockMutex;// Keeps the playback clock continuous when the speed changes
 		
 		Movie_video *m_video;
 		Movie_audio *m_audio;
@@ -0,0 +1,194 @@
+/*
+ *  Playlist.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+
+#ifndef PLAYLIST_HPP
+#define PLAYLIST_HPP
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/Transformable.hpp>
+#include <SFML/System/Mutex.hpp>
+#include <SFML/System/Thread.hpp>
+#include <SFML/System/Time.hpp>
+#include <sfeMovie/Config.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <string>
+#include <vector>
+
+namespace sfe {
+	/** @brief Plays a list of movies one after the other, without any gap
+	 *
+	 * While a movie is playing, the next one is opened and prerolled on a background
+	 * thread, so that it starts on the frame following the end of the current one.
+	 * An optional crossfade plays both movies at the same time during the transition,
+	 * fading the image and sound of the next movie in.
+	 *
+	 * update() must be called once per frame, before drawing the playlist.
+	 */
+	class SFE_API Playlist : public sf::Drawable, public sf::Transformable {
+	public:
+		/** @brief Default constructor
+		 */
+		Playlist(void);
+		
+		
+		/** @brief Default destructor
+		 */
+		~Playlist(void);
+		
+		
+		/** @brief Appends a movie file to the playlist
+		 *
+		 * @param filename the path to the movie file
+		 */
+		void add(const std::string& filename);
+		
+		
+		/** @brief Stops the playback and removes all the movies from the playlist
+		 */
+		void clear(void);
+		
+		
+		/** @brief Returns the amount of movies in the playlist
+		 */
+		unsigned getCount(void) const;
+		
+		
+		/** @brief Sets whether the playlist starts over after its last movie (default is false)
+		 */
+		void setLoop(bool flag);
+		
+		
+		/** @brief Returns whether the playlist starts over after its last movie
+		 */
+		bool getLoop(void) const;
+		
+		
+		/** @brief Sets the duration during which two consecutive movies are played together
+		 *
+		 * The default is zero: the next movie starts right after the last frame
+		 * of the current one.
+		 *
+		 * @param duration the crossfade duration
+		 */
+		void setCrossfade(sf::Time duration);
+		
+		
+		/** @brief Returns the crossfade duration
+		 */
+		sf::Time getCrossfade(void) const;
+		
+		
+		/** @brief Sets the volume of the movies (default is 100)
+		 *
+		 * @param volume the volume in range [0, 100]
+		 */
+		void setVolume(float volume);
+		
+		
+		/** @brief Returns the volume of the movies
+		 */
+		float getVolume(void) const;
+		
+		
+		/** @brief Starts playing the first movie of the playlist, or resumes a paused playback
+		 *
+		 * The first movie is opened in the calling thread.
+		 *
+		 * @return true on success, false if no movie of the playlist could be opened
+		 */
+		bool play(void);
+		
+		
+		/** @brief Pauses the playback
+		 */
+		void pause(void);
+		
+		
+		/** @brief Stops the playback, the next call to play() starts from the first movie
+		 */
+		void stop(void);
+		
+		
+		/** @brief Returns whether a movie is playing
+		 */
+		bool isPlaying(void) const;
+		
+		
+		/** @brief Switches to the next movie when the current one ends
+		 *
+		 * This must be called once per frame, from the thread drawing the playlist.
+		 */
+		void update(void);
+		
+		
+		/** @brief Returns the index of the movie being played
+		 */
+		unsigned getCurrentIndex(void) const;
+		
+		
+		/** @brief Returns the movie being played
+		 *
+		 * The returned movie changes when the playlist switches to the next one.
+		 */
+		const Movie& getCurrentMovie(void) const;
+		
+	private:
+		enum PreparationState
+		{
+			Idle,
+			Preparing,
+			Ready,
+			Failed
+		};
+		
+		void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+		
+		void prepare(void);
+		void startPreparing(unsigned index);
+		PreparationState getPreparationState(void) const;
+		bool getFollowingIndex(unsigned index, unsigned& following) const;
+		void switchToNext(void);
+		
+		std::vector<std::string> m_files;
+		Movie *m_current;			// Movie being played
+		Movie *m_next;				// Movie being prepared by m_prepareThread
+		unsigned m_currentIndex;
+		unsigned m_nextIndex;
+		unsigned m_failedCount;		// Consecutive files that could not be prepared
+		
+		sf::Thread m_prepareThread;
+		PreparationState m_preparationState;
+		mutable sf::Mutex m_preparationMutex;
+		
+		bool m_isPlaying;
+		bool m_isCrossfading;
+		bool m_loop;
+		sf::Time m_crossfade;
+		float m_volume;
+	};
+	
+} // namespace sfe
+
+#endif
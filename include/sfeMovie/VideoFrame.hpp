@@ -0,0 +1,145 @@
+/*
+ *  VideoFrame.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+#ifndef VIDEO_FRAME_HPP
+#define VIDEO_FRAME_HPP
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Config.hpp>
+#include <sfeMovie/Config.hpp>
+
+namespace sfe {
+	class FrameBuffer;
+
+	/** @brief A decoded video frame, in the native pixel format of the movie
+	 *
+	 * Copying a VideoFrame doesn't copy the pixels: copies share the same
+	 * reference counted planes, which are freed when the last copy is destroyed.
+	 * Thus you can keep the frames given to FrameSink::onFrame() as long as you
+	 * need them.
+	 *
+	 * If the video decoder doesn't support decoding into sfeMovie's buffers,
+	 * the first copy of a frame copies its pixels once.
+	 */
+	class SFE_API VideoFrame {
+	public:
+		enum
+		{
+			MaxPlanes = 4 //!< Maximum amount of planes in a frame
+		};
+
+		/** @brief Constructs an invalid frame
+		 */
+		VideoFrame(void);
+
+		/** @brief Shares the planes of @a other
+		 */
+		VideoFrame(const VideoFrame& other);
+
+		/** @brief Shares the planes of @a other
+		 */
+		VideoFrame& operator=(const VideoFrame& other);
+
+		/** @brief Releases this reference to the planes
+		 */
+		~VideoFrame(void);
+
+
+		/** @brief Returns whether the frame holds any picture
+		 */
+		bool isValid(void) const;
+
+
+		/** @brief Returns the pixels of the given plane
+		 *
+		 * @param plane the plane index, in range [0, MaxPlanes)
+		 * @return the first pixel of the plane, or NULL if the pixel format has less planes
+		 */
+		const sf::Uint8 *getData(unsigned plane) const;
+
+
+		/** @brief Returns the size in bytes of one line of the given plane, padding included
+		 *
+		 * @param plane the plane index, in range [0, MaxPlanes)
+		 */
+		int getLineSize(unsigned plane) const;
+
+
+		/** @brief Returns the pixel format of the frame
+		 *
+		 * @return the FFmpeg PixelFormat value (eg. PIX_FMT_YUV420P)
+		 */
+		int getPixelFormat(void) const;
+
+
+		/** @brief Returns the size of the picture in pixels
+		 */
+		sf::Vector2i getSize(void) const;
+
+
+		/** @brief Returns the presentation time of the frame, from the beginning of the movie
+		 */
+		sf::Time getTimestamp(void) const;
+
+	private:
+		friend class Movie_video;
+		friend class ReverseDecoder;
+
+		void reset(void);
+
+		const sf::Uint8 *m_data[MaxPlanes];
+		int m_lineSize[MaxPlanes];
+		int m_pixelFormat;
+		sf::Vector2i m_size;
+		sf::Time m_timestamp;
+		FrameBuffer *m_buffer; // Owner of the planes, NULL if they belong to the decoder
+	};
+
+
+	/** @brief Interface for receiving the decoded video frames of a movie
+	 *
+	 * @see Movie::setFrameSink
+	 */
+	class SFE_API FrameSink {
+	public:
+		virtual ~FrameSink(void) {}
+
+		/** @brief Called for every decoded video frame
+		 *
+		 * This is called from the decoding thread, before the frame is converted
+		 * for display, thus it should return quickly. The given frame is only
+		 * valid during the call, copy it to keep it.
+		 *
+		 * Frames that are not displayed because the playback is late are
+		 * given to the sink too.
+		 *
+		 * @param frame the decoded frame
+		 */
+		virtual void onFrame(const VideoFrame& frame) = 0;
+	};
+
+} // namespace sfe
+
+#endif
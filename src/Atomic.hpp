@@ -0,0 +1,79 @@
+/*
+ *  Atomic.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef ATOMIC_HPP
+#define ATOMIC_HPP
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+namespace sfe {
+
+/* Minimal set of atomic operations on long integers, all of them acting
+ * as full memory barriers
+ */
+
+inline long atomicLoad(volatile long *var)
+{
+#ifdef _MSC_VER
+	return InterlockedCompareExchange(var, 0, 0);
+#else
+	return __sync_fetch_and_add(var, 0);
+#endif
+}
+
+inline void atomicStore(volatile long *var, long value)
+{
+#ifdef _MSC_VER
+	InterlockedExchange(var, value);
+#else
+	__sync_synchronize();
+	*var = value;
+	__sync_synchronize();
+#endif
+}
+
+// Returns the value of @var before the addition
+inline long atomicFetchAndAdd(volatile long *var, long value)
+{
+#ifdef _MSC_VER
+	return InterlockedExchangeAdd(var, value);
+#else
+	return __sync_fetch_and_add(var, value);
+#endif
+}
+
+// Sets @var to @value if it equals @expected, returns whether it did
+inline bool atomicCompareAndSwap(volatile long *var, long expected, long value)
+{
+#ifdef _MSC_VER
+	return InterlockedCompareExchange(var, value, expected) == expected;
+#else
+	return __sync_bool_compare_and_swap(var, expected, value);
+#endif
+}
+
+} // namespace sfe
+
+#endif
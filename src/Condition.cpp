@@ -23,6 +23,7 @@
  */
 
 #include "Condition.hpp"
+#include "Trace.hpp"
 #include <SFML/Config.hpp>
 #include <iostream>
 
@@ -56,7 +57,11 @@ void Condition::lock(void)
 	
 bool Condition::waitAndLock(int awaitedValue, bool autorelease)
 {
-	bool flag = m_impl->waitAndRetain(awaitedValue);
+	bool flag;
+	{
+		TRACE_SCOPE("Condition::waitAndLock");
+		flag = m_impl->waitAndRetain(awaitedValue);
+	}
 	
 	if (autorelease)
 		m_impl->release(awaitedValue);
@@ -64,6 +69,20 @@ bool Condition::waitAndLock(int awaitedValue, bool autorelease)
 	return flag;
 }
 
+bool Condition::waitAndLock(int awaitedValue, sf::Time timeout, bool autorelease)
+{
+	bool flag;
+	{
+		TRACE_SCOPE("Condition::waitAndLock");
+		flag = m_impl->waitAndRetain(awaitedValue, timeout);
+	}
+	
+	if (flag && autorelease)
+		m_impl->release(awaitedValue);
+	
+	return flag;
+}
+
 void Condition::unlock(int value)
 {
 	m_impl->release(value);
@@ -90,6 +109,11 @@ void Condition::signal(void)
 	m_impl->signal();
 }
 
+void Condition::broadcast(void)
+{
+	m_impl->broadcast();
+}
+
 void Condition::invalidate(void)
 {
 	m_impl->invalidate();
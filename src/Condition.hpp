@@ -25,6 +25,8 @@
 #ifndef CONDITION_HPP
 #define CONDITION_HPP
 
+#include <SFML/System/Time.hpp>
+
 namespace sfe {
 
 class ConditionImpl;
@@ -71,6 +73,17 @@ public:
 	 */
 	bool waitAndLock(int awaitedValue, bool autoUnlock = false);
 	
+	/* Same as waitAndLock(int, bool) but gives up once @timeout has elapsed.
+	 * The deadline is computed when the call starts, thus a thread can sleep
+	 * until an exact point in time while still being woken up by the changes
+	 * of the Condition.
+	 *
+	 * @return: true if the @awaitedValue has been reached in time, false if
+	 * the timeout expired or the Condition has been invalidated.
+	 * The Condition is unlocked when false is returned.
+	 */
+	bool waitAndLock(int awaitedValue, sf::Time timeout, bool autoUnlock = false);
+	
 	/* Unlocks a previously locked Condition with @value as
 	 * internal value. When the condition is unlocked, it is assumed
 	 * to have the given value. The condition is thereafter signaled.
@@ -107,9 +120,16 @@ public:
 	 */
 	void signal(void);
 	
+	/* Same as signal() but wakes up all the waiting threads instead of one
+	 * of them, for when they wait for different values
+	 */
+	void broadcast(void);
+	
 	/* Signals the Condition and disables blocking calls,
 	 * thus WaitAndLock() does no more wait whatever
-	 * the awaitedValue is and waiting calls are unlocked, returning false.
+	 * the awaitedValue is and all waiting calls are unlocked, returning false.
+	 * Blocks while the Condition is locked, thus must not be called by
+	 * the thread holding it.
 	 */
 	void invalidate(void);
 	
@@ -0,0 +1,261 @@
+/*
+ *  DecodePool.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "DecodePool.hpp"
+#include "Trace.hpp"
+#include "Atomic.hpp"
+#include <SFML/Config.hpp>
+
+#ifdef SFML_SYSTEM_WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace sfe {
+
+	static sf::Mutex g_poolInstanceMutex;
+	static bool g_usesDecodePool = false;
+
+	DecodePool::Worker::Worker(DecodePool& pool, unsigned index) :
+	m_pool(pool),
+	m_index(index),
+	m_tasks(),
+	m_tasksMutex(),
+	m_thread(&DecodePool::Worker::run, this)
+	{
+	}
+
+	void DecodePool::Worker::run(void)
+	{
+		Trace::setThreadName("sfeMovie decode pool");
+
+		while (m_pool.m_hasWork.waitAndLock(1, Condition::AutoUnlock))
+		{
+			Task *task = m_pool.popTask(m_index);
+
+			if (task)
+				task->execute();
+		}
+	}
+
+	DecodePool& DecodePool::instance(void)
+	{
+		sf::Lock l(g_poolInstanceMutex);
+		static DecodePool pool(detectCoreCount());
+		return pool;
+	}
+
+	void DecodePool::setEnabled(bool flag)
+	{
+		g_usesDecodePool = flag;
+
+		// Spawn the workers now rather than on the first decoded frame
+		if (flag)
+			instance();
+	}
+
+	bool DecodePool::isEnabled(void)
+	{
+		return g_usesDecodePool;
+	}
+
+	DecodePool::DecodePool(unsigned workerCount) :
+	m_workers(),
+	m_nextWorker(0),
+	m_pendingTasks(0),
+	m_pendingMutex(),
+	m_hasWork(0),
+	m_delayedTasks(),
+	m_delayedMutex(),
+	m_timerWakeUp(0),
+	m_isTimerRunning(1),
+	m_clock(),
+	m_timerThread(&DecodePool::runTimer, this)
+	{
+		for (unsigned i = 0; i < workerCount; i++)
+		{
+			m_workers.push_back(new Worker(*this, i));
+			m_workers.back()->m_thread.launch();
+		}
+
+		m_timerThread.launch();
+	}
+
+	DecodePool::~DecodePool(void)
+	{
+		atomicStore(&m_isTimerRunning, 0);
+		m_timerWakeUp.invalidate();
+		m_timerThread.wait();
+
+		m_hasWork.invalidate();
+
+		for (unsigned i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i]->m_thread.wait();
+			delete m_workers[i];
+		}
+	}
+
+	void DecodePool::push(Task *task)
+	{
+		sf::Lock l(m_pendingMutex);
+		Worker *worker = m_workers[m_nextWorker];
+		m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+
+		worker->m_tasksMutex.lock();
+		worker->m_tasks.push_back(task);
+		worker->m_tasksMutex.unlock();
+
+		m_pendingTasks++;
+		m_hasWork = 1;
+	}
+
+	void DecodePool::push(Task *task, sf::Time delay)
+	{
+		if (delay <= sf::Time::Zero)
+		{
+			push(task);
+			return;
+		}
+
+		m_delayedMutex.lock();
+		sf::Int64 deadline = (m_clock.getElapsedTime() + delay).asMicroseconds();
+		m_delayedTasks.insert(std::make_pair(deadline, task));
+		m_delayedMutex.unlock();
+
+		m_timerWakeUp = 1;
+	}
+
+	void DecodePool::wakeUp(Task *task)
+	{
+		bool wasDelayed = false;
+
+		m_delayedMutex.lock();
+		for (DelayedTaskMap::iterator it = m_delayedTasks.begin(); it != m_delayedTasks.end(); ++it)
+		{
+			if (it->second == task)
+			{
+				m_delayedTasks.erase(it);
+				wasDelayed = true;
+				break;
+			}
+		}
+		m_delayedMutex.unlock();
+
+		if (wasDelayed)
+			push(task);
+	}
+
+	void DecodePool::runTimer(void)
+	{
+		Trace::setThreadName("sfeMovie decode pool timer");
+
+		while (atomicLoad(&m_isTimerRunning))
+		{
+			std::vector<Task *> dueTasks;
+			sf::Time timeout = sf::Time::Zero;
+
+			m_delayedMutex.lock();
+
+			// Tasks delayed from now on set the value back to 1, and thus
+			// cut the wait below short
+			m_timerWakeUp = 0;
+			sf::Int64 now = m_clock.getElapsedTime().asMicroseconds();
+
+			while (!m_delayedTasks.empty() && m_delayedTasks.begin()->first <= now)
+			{
+				dueTasks.push_back(m_delayedTasks.begin()->second);
+				m_delayedTasks.erase(m_delayedTasks.begin());
+			}
+
+			if (!m_delayedTasks.empty())
+				timeout = sf::microseconds(m_delayedTasks.begin()->first - now);
+
+			m_delayedMutex.unlock();
+
+			for (unsigned i = 0; i < dueTasks.size(); i++)
+				push(dueTasks[i]);
+
+			if (timeout > sf::Time::Zero)
+				m_timerWakeUp.waitAndLock(1, timeout, Condition::AutoUnlock);
+			else
+				m_timerWakeUp.waitAndLock(1, Condition::AutoUnlock);
+		}
+	}
+
+	DecodePool::Task *DecodePool::popTask(unsigned workerIndex)
+	{
+		Task *task = NULL;
+
+		// Take the oldest task of our own queue first, then try to steal
+		// the most recent task of the other workers
+		for (unsigned i = 0; !task && i < m_workers.size(); i++)
+		{
+			Worker *victim = m_workers[(workerIndex + i) % m_workers.size()];
+			sf::Lock l(victim->m_tasksMutex);
+
+			if (!victim->m_tasks.empty())
+			{
+				if (i == 0)
+				{
+					task = victim->m_tasks.front();
+					victim->m_tasks.pop_front();
+				}
+				else
+				{
+					task = victim->m_tasks.back();
+					victim->m_tasks.pop_back();
+				}
+			}
+		}
+
+		sf::Lock l(m_pendingMutex);
+
+		if (task)
+			m_pendingTasks--;
+
+		if (m_pendingTasks == 0)
+			m_hasWork = 0;
+		else
+			m_hasWork.signal(); // More work for another sleeping worker
+
+		return task;
+	}
+
+	unsigned DecodePool::detectCoreCount(void)
+	{
+		long count = 0;
+
+#ifdef SFML_SYSTEM_WINDOWS
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		count = info.dwNumberOfProcessors;
+#else
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+		return (count > 0) ? (unsigned)count : 1;
+	}
+
+} // namespace sfe
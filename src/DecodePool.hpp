@@ -0,0 +1,121 @@
+/*
+ *  DecodePool.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef DECODE_POOL_HPP
+#define DECODE_POOL_HPP
+
+#include <SFML/System.hpp>
+#include <deque>
+#include <map>
+#include <vector>
+#include "Condition.hpp"
+
+namespace sfe {
+
+/* Process-wide pool of worker threads shared by all the Movie instances.
+ * When enabled through Movie::useSharedDecodePool(), the video decoding of
+ * every movie is scheduled as short tasks on this pool instead of each movie
+ * owning its own decoding thread.
+ *
+ * Each worker owns a task queue. Tasks are distributed round-robin and idle
+ * workers steal tasks from the other queues. Tasks that must not run before
+ * a deadline wait on a timer thread, so that they never hold a worker while
+ * waiting.
+ */
+class DecodePool {
+public:
+	/* Unit of work executed by the pool
+	 */
+	class Task {
+	public:
+		virtual ~Task(void) {}
+		virtual void execute(void) = 0;
+	};
+
+	/* Returns the shared pool, creating its workers on first call
+	 */
+	static DecodePool& instance(void);
+
+	/* Whether new playbacks should schedule their decoding on the shared pool
+	 */
+	static void setEnabled(bool flag);
+	static bool isEnabled(void);
+
+	~DecodePool(void);
+
+	/* Schedules @task on one of the workers. The task must remain valid
+	 * until it has been executed.
+	 */
+	void push(Task *task);
+
+	/* Schedules @task once @delay has elapsed. The task must remain valid
+	 * until it has been executed.
+	 */
+	void push(Task *task, sf::Time delay);
+
+	/* Schedules @task right away if it is waiting for its delay, does
+	 * nothing otherwise
+	 */
+	void wakeUp(Task *task);
+
+	/* Returns the amount of processor cores, at least 1
+	 */
+	static unsigned detectCoreCount(void);
+
+private:
+	struct Worker {
+		Worker(DecodePool& pool, unsigned index);
+		void run(void);
+
+		DecodePool& m_pool;
+		unsigned m_index;
+		std::deque<Task *> m_tasks;
+		sf::Mutex m_tasksMutex;
+		sf::Thread m_thread;
+	};
+	friend struct Worker;
+
+	DecodePool(unsigned workerCount);
+
+	Task *popTask(unsigned workerIndex);
+	void runTimer(void);
+
+	typedef std::multimap<sf::Int64, Task *> DelayedTaskMap; // By deadline on m_clock, in microseconds
+
+	std::vector<Worker *> m_workers;
+	unsigned m_nextWorker;		// Round-robin index of the next worker to feed
+	unsigned m_pendingTasks;	// Tasks waiting in all the queues
+	sf::Mutex m_pendingMutex;	// Protects m_nextWorker and m_pendingTasks
+	Condition m_hasWork;		// 1 when at least one task is pending
+
+	DelayedTaskMap m_delayedTasks;
+	sf::Mutex m_delayedMutex;	// Protects m_delayedTasks
+	Condition m_timerWakeUp;	// Set to 1 when a task is delayed, for the timer to check its deadline
+	volatile long m_isTimerRunning;
+	sf::Clock m_clock;
+	sf::Thread m_timerThread;
+};
+
+} // namespace sfe
+
+#endif
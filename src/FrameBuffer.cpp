@@ -0,0 +1,130 @@
+/*
+ *  FrameBuffer.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "FrameBuffer.hpp"
+#include "FrameBufferPool.hpp"
+#include "Atomic.hpp"
+
+extern "C"
+{
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+}
+
+namespace sfe {
+
+	FrameBuffer::FrameBuffer(void) :
+	m_refCount(1),
+	m_block(NULL),
+	m_blockSize(0),
+	m_format(PIX_FMT_NONE),
+	m_width(0),
+	m_height(0),
+	m_lineAlign(0)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			data[i] = NULL;
+			lineSize[i] = 0;
+		}
+	}
+
+	FrameBuffer::~FrameBuffer(void)
+	{
+		av_free(m_block);
+	}
+
+	FrameBuffer *FrameBuffer::create(enum PixelFormat format, int width, int height, int lineAlign)
+	{
+		FrameBuffer *buffer = FrameBufferPool::acquire(format, width, height, lineAlign);
+
+		if (buffer)
+			return buffer;
+
+		buffer = new FrameBuffer;
+
+		if (av_image_fill_linesizes(buffer->lineSize, format, width) < 0)
+		{
+			delete buffer;
+			return NULL;
+		}
+
+		for (int i = 0; i < 4; i++)
+			buffer->lineSize[i] = FFALIGN(buffer->lineSize[i], lineAlign);
+
+		// First call only computes the total size
+		int size = av_image_fill_pointers(buffer->data, format, height, NULL, buffer->lineSize);
+
+		if (size < 0 || NULL == (buffer->m_block = (uint8_t *)av_malloc(size + FF_INPUT_BUFFER_PADDING_SIZE)))
+		{
+			delete buffer;
+			return NULL;
+		}
+
+		buffer->m_blockSize = size + FF_INPUT_BUFFER_PADDING_SIZE;
+		buffer->m_format = format;
+		buffer->m_width = width;
+		buffer->m_height = height;
+		buffer->m_lineAlign = lineAlign;
+
+		av_image_fill_pointers(buffer->data, format, height, buffer->m_block, buffer->lineSize);
+		return buffer;
+	}
+
+	FrameBuffer *FrameBuffer::copy(const uint8_t * const data[4], const int lineSize[4],
+								   enum PixelFormat format, int width, int height)
+	{
+		FrameBuffer *buffer = create(format, width, height);
+
+		if (buffer)
+		{
+			av_image_copy(buffer->data, buffer->lineSize,
+						  const_cast<const uint8_t **>(data), lineSize,
+						  format, width, height);
+		}
+
+		return buffer;
+	}
+
+	void FrameBuffer::retain(void)
+	{
+		atomicFetchAndAdd(&m_refCount, 1);
+	}
+
+	void FrameBuffer::release(void)
+	{
+		if (atomicFetchAndAdd(&m_refCount, -1) == 1)
+			FrameBufferPool::recycle(this);
+	}
+
+	bool FrameBuffer::matches(enum PixelFormat format, int width, int height, int lineAlign) const
+	{
+		return m_format == format && m_width == width && m_height == height && m_lineAlign == lineAlign;
+	}
+
+	std::size_t FrameBuffer::getSize(void) const
+	{
+		return m_blockSize;
+	}
+
+} // namespace sfe
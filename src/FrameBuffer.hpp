@@ -0,0 +1,91 @@
+/*
+ *  FrameBuffer.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef FRAME_BUFFER_HPP
+#define FRAME_BUFFER_HPP
+
+#include <cstddef>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+namespace sfe {
+
+/* Reference counted picture planes, allocated in a single aligned block.
+ * Used as decoding target by the video decoder so that the decoded pictures
+ * can be handed out as VideoFrame objects without being copied.
+ *
+ * Released buffers go back to the FrameBufferPool and are reused by the next
+ * create() call asking for the same picture layout.
+ */
+class FrameBuffer {
+public:
+	/* Allocates planes for a @width x @height picture in @format, with each
+	 * line size rounded up to a multiple of @lineAlign bytes, or takes a
+	 * matching buffer from the pool.
+	 * The buffer starts with one reference. Returns NULL on allocation error
+	 */
+	static FrameBuffer *create(enum PixelFormat format, int width, int height, int lineAlign = 32);
+
+	/* Allocates a new buffer and copies the given picture into it
+	 */
+	static FrameBuffer *copy(const uint8_t * const data[4], const int lineSize[4],
+							 enum PixelFormat format, int width, int height);
+
+	void retain(void);
+
+	/* Drops one reference, the buffer is given back to the pool with the last one
+	 */
+	void release(void);
+
+	/* Returns whether the buffer has been created for the given picture layout
+	 */
+	bool matches(enum PixelFormat format, int width, int height, int lineAlign) const;
+
+	/* Returns the size in bytes of the allocated block
+	 */
+	std::size_t getSize(void) const;
+
+	uint8_t *data[4];
+	int lineSize[4];
+
+private:
+	friend class FrameBufferPool;
+
+	FrameBuffer(void);
+	~FrameBuffer(void);
+
+	volatile long m_refCount;
+	uint8_t *m_block;
+	std::size_t m_blockSize;
+	enum PixelFormat m_format;
+	int m_width;
+	int m_height;
+	int m_lineAlign;
+};
+
+} // namespace sfe
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ *  FrameBufferPool.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "FrameBufferPool.hpp"
+#include "FrameBuffer.hpp"
+#include "Atomic.hpp"
+
+// Enough for the decoding buffers and the RGBA frames of a few 1080p movies
+#define DEFAULT_POOL_CAPACITY (64 * 1024 * 1024)
+
+namespace sfe {
+
+	static sf::Mutex g_poolInstanceMutex;
+	static bool g_isPoolDestroyed = false;
+
+	FrameBufferPool::FrameBufferPool(void) :
+	m_buffers(),
+	m_size(0),
+	m_capacity(DEFAULT_POOL_CAPACITY),
+	m_mutex()
+	{
+	}
+
+	FrameBufferPool::~FrameBufferPool(void)
+	{
+		sf::Lock l(m_mutex);
+		trim(0);
+
+		// Buffers still referenced by static objects are freed directly from now on
+		g_isPoolDestroyed = true;
+	}
+
+	FrameBufferPool& FrameBufferPool::instance(void)
+	{
+		sf::Lock l(g_poolInstanceMutex);
+		static FrameBufferPool pool;
+		return pool;
+	}
+
+	FrameBuffer *FrameBufferPool::acquire(enum PixelFormat format, int width, int height, int lineAlign)
+	{
+		if (g_isPoolDestroyed)
+			return NULL;
+
+		FrameBufferPool& pool = instance();
+		sf::Lock l(pool.m_mutex);
+
+		for (std::list<FrameBuffer *>::iterator it = pool.m_buffers.begin(); it != pool.m_buffers.end(); ++it)
+		{
+			FrameBuffer *buffer = *it;
+
+			if (buffer->matches(format, width, height, lineAlign))
+			{
+				pool.m_buffers.erase(it);
+				pool.m_size -= buffer->getSize();
+				atomicStore(&buffer->m_refCount, 1);
+				return buffer;
+			}
+		}
+
+		return NULL;
+	}
+
+	void FrameBufferPool::recycle(FrameBuffer *buffer)
+	{
+		if (g_isPoolDestroyed)
+		{
+			delete buffer;
+			return;
+		}
+
+		FrameBufferPool& pool = instance();
+		sf::Lock l(pool.m_mutex);
+
+		if (buffer->getSize() > pool.m_capacity)
+		{
+			delete buffer;
+			return;
+		}
+
+		pool.trim(pool.m_capacity - buffer->getSize());
+		pool.m_buffers.push_front(buffer);
+		pool.m_size += buffer->getSize();
+	}
+
+	void FrameBufferPool::setCapacity(std::size_t bytes)
+	{
+		FrameBufferPool& pool = instance();
+		sf::Lock l(pool.m_mutex);
+
+		pool.m_capacity = bytes;
+		pool.trim(bytes);
+	}
+
+	std::size_t FrameBufferPool::getCapacity(void)
+	{
+		FrameBufferPool& pool = instance();
+		sf::Lock l(pool.m_mutex);
+
+		return pool.m_capacity;
+	}
+
+	void FrameBufferPool::purge(void)
+	{
+		FrameBufferPool& pool = instance();
+		sf::Lock l(pool.m_mutex);
+
+		pool.trim(0);
+	}
+
+	void FrameBufferPool::trim(std::size_t capacity)
+	{
+		while (m_size > capacity && !m_buffers.empty())
+		{
+			FrameBuffer *buffer = m_buffers.back();
+			m_buffers.pop_back();
+			m_size -= buffer->getSize();
+			delete buffer;
+		}
+	}
+
+} // namespace sfe
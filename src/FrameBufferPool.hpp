@@ -0,0 +1,89 @@
+/*
+ *  FrameBufferPool.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef FRAME_BUFFER_POOL_HPP
+#define FRAME_BUFFER_POOL_HPP
+
+#include <SFML/System.hpp>
+#include <list>
+#include <cstddef>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+namespace sfe {
+
+class FrameBuffer;
+
+/* Process-wide cache of unused FrameBuffer objects.
+ *
+ * When the last reference to a FrameBuffer is released, its block is kept
+ * here instead of being freed, and FrameBuffer::create() takes it back for
+ * the next picture of the same format, size and line alignment. Thus opening
+ * and closing movies, or decoding with many movies at once, reuses the same
+ * few blocks rather than fragmenting the heap.
+ *
+ * The total size of the cached blocks is bounded by a capacity, the least
+ * recently released blocks are freed first when it is exceeded.
+ */
+class FrameBufferPool {
+public:
+	/* Returns an unused buffer matching the given picture, with one reference,
+	 * or NULL if there is none
+	 */
+	static FrameBuffer *acquire(enum PixelFormat format, int width, int height, int lineAlign);
+
+	/* Keeps @buffer, which has no reference left, for later reuse or frees it
+	 * if the pool is full
+	 */
+	static void recycle(FrameBuffer *buffer);
+
+	/* Maximum amount of bytes kept by the pool, 0 disables the pooling
+	 */
+	static void setCapacity(std::size_t bytes);
+	static std::size_t getCapacity(void);
+
+	/* Frees all the cached buffers
+	 */
+	static void purge(void);
+
+private:
+	FrameBufferPool(void);
+	~FrameBufferPool(void);
+
+	static FrameBufferPool& instance(void);
+
+	// Frees the least recently released buffers until the pool fits in @capacity
+	void trim(std::size_t capacity);
+
+	std::list<FrameBuffer *> m_buffers; // Most recently released first
+	std::size_t m_size;
+	std::size_t m_capacity;
+	sf::Mutex m_mutex;
+};
+
+} // namespace sfe
+
+#endif
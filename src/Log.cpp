@@ -0,0 +1,221 @@
+/*
+ *  Log.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "Log.hpp"
+#include "Atomic.hpp"
+#include "Condition.hpp"
+#include <SFML/System.hpp>
+#include <cstdarg>
+#include <cstdio>
+
+#define LOG_RING_SIZE 1024		// Must be a power of 2
+#define LOG_MESSAGE_SIZE 256	// Longer messages are truncated
+
+namespace sfe {
+
+	namespace {
+		const char *levelPrefix(int level)
+		{
+			switch (level)
+			{
+				case SFE_LOG_ERROR:		return "error: ";
+				case SFE_LOG_WARNING:	return "warning: ";
+				default:				return "";
+			}
+		}
+
+		struct LogSlot {
+			volatile long sequence;	// Slot state, see LogWriter
+			int level;
+			sf::Int64 time;
+			char message[LOG_MESSAGE_SIZE];
+		};
+
+		/* Bounded multiple producers / single consumer ring.
+		 *
+		 * A slot whose sequence equals the enqueue position is free for this position,
+		 * sequence == position + 1 means the slot has been filled and can be read.
+		 * Producers reserve a position with a compare-and-swap, thus never wait
+		 * for each other nor for the writer. They only wake up the writer when
+		 * it has emptied the ring.
+		 */
+		class LogWriter {
+		public:
+			LogWriter(void) :
+			m_enqueuePos(0),
+			m_dequeuePos(0),
+			m_droppedCount(0),
+			m_isRunning(0),
+			m_wakeUp(0),
+			m_startMutex(),
+			m_thread(&LogWriter::run, this),
+			m_clock()
+			{
+				for (long i = 0; i < LOG_RING_SIZE; i++)
+					m_slots[i].sequence = i;
+			}
+
+			~LogWriter(void)
+			{
+				if (atomicLoad(&m_isRunning))
+				{
+					atomicStore(&m_isRunning, 0);
+					m_wakeUp.invalidate();
+					m_thread.wait();
+				}
+
+				drain();
+			}
+
+			void push(int level, const char *format, va_list args)
+			{
+				long pos = atomicLoad(&m_enqueuePos);
+				LogSlot *slot = NULL;
+
+				while (!slot)
+				{
+					LogSlot *candidate = &m_slots[pos & (LOG_RING_SIZE - 1)];
+					long diff = atomicLoad(&candidate->sequence) - pos;
+
+					if (diff == 0)
+					{
+						if (atomicCompareAndSwap(&m_enqueuePos, pos, pos + 1))
+							slot = candidate;
+						else
+							pos = atomicLoad(&m_enqueuePos);
+					}
+					else if (diff < 0)
+					{
+						// The writer didn't catch up, drop the message
+						atomicFetchAndAdd(&m_droppedCount, 1);
+						return;
+					}
+					else
+					{
+						pos = atomicLoad(&m_enqueuePos);
+					}
+				}
+
+				slot->level = level;
+				slot->time = m_clock.getElapsedTime().asMicroseconds();
+				vsnprintf(slot->message, LOG_MESSAGE_SIZE, format, args);
+				atomicStore(&slot->sequence, pos + 1);
+
+				// The writer resets the condition before draining, thus this message
+				// is written even when the writer isn't woken up
+				if (m_wakeUp.value() == 0)
+					m_wakeUp = 1;
+
+				ensureStarted();
+			}
+
+		private:
+			void ensureStarted(void)
+			{
+				if (!atomicLoad(&m_isRunning))
+				{
+					sf::Lock l(m_startMutex);
+
+					if (!atomicLoad(&m_isRunning))
+					{
+						atomicStore(&m_isRunning, 1);
+						m_thread.launch();
+					}
+				}
+			}
+
+			void run(void)
+			{
+				while (atomicLoad(&m_isRunning))
+				{
+					m_wakeUp = 0;
+
+					if (!drain())
+						m_wakeUp.waitAndLock(1, Condition::AutoUnlock);
+				}
+			}
+
+			// Writes all the readable messages, returns whether there was any
+			bool drain(void)
+			{
+				bool didWrite = false;
+				long dropped = atomicLoad(&m_droppedCount);
+
+				if (dropped)
+				{
+					atomicFetchAndAdd(&m_droppedCount, -dropped);
+					fprintf(stderr, "[sfeMovie] %ld log messages dropped\n", dropped);
+				}
+
+				for (;;)
+				{
+					long pos = atomicLoad(&m_dequeuePos);
+					LogSlot *slot = &m_slots[pos & (LOG_RING_SIZE - 1)];
+
+					if (atomicLoad(&slot->sequence) != pos + 1)
+						break;
+
+					fprintf(stderr, "[%.3fs] %s%s\n", slot->time / 1000000.,
+							levelPrefix(slot->level), slot->message);
+
+					atomicStore(&slot->sequence, pos + LOG_RING_SIZE);
+					atomicStore(&m_dequeuePos, pos + 1);
+					didWrite = true;
+				}
+
+				if (didWrite)
+					fflush(stderr);
+
+				return didWrite;
+			}
+
+			LogSlot m_slots[LOG_RING_SIZE];
+			volatile long m_enqueuePos;
+			volatile long m_dequeuePos;
+			volatile long m_droppedCount;
+			volatile long m_isRunning;
+			Condition m_wakeUp;		// Set to 1 by push() when the writer may be waiting
+			sf::Mutex m_startMutex;
+			sf::Thread m_thread;
+			sf::Clock m_clock;
+		};
+
+		LogWriter g_logWriter;
+	}
+
+	int Log::s_level = SFE_LOG_WARNING;
+
+	void Log::setLevel(int level)
+	{
+		s_level = level;
+	}
+
+	void Log::write(int level, const char *format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		g_logWriter.push(level, format, args);
+		va_end(args);
+	}
+
+} // namespace sfe
@@ -0,0 +1,105 @@
+/*
+ *  Log.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef LOG_HPP
+#define LOG_HPP
+
+// Log levels, from the least to the most verbose
+#define SFE_LOG_NONE 0
+#define SFE_LOG_ERROR 1
+#define SFE_LOG_WARNING 2
+#define SFE_LOG_INFO 3
+#define SFE_LOG_DEBUG 4
+
+// Most verbose level compiled in, messages above it cost nothing at all.
+// Set by the SFEMOVIE_LOG_LEVEL CMake option
+#ifndef SFE_COMPILED_LOG_LEVEL
+#define SFE_COMPILED_LOG_LEVEL SFE_LOG_DEBUG
+#endif
+
+namespace sfe {
+
+/* Asynchronous logger.
+ *
+ * Messages are formatted by the calling thread straight into a slot of a
+ * lock-free ring buffer and written to the error output by a background
+ * thread, so that logging never blocks the decoding or rendering threads.
+ * When the ring is full, messages are dropped and the amount of dropped
+ * messages is reported by the writer.
+ *
+ * Use the LOG_* macros rather than calling write() directly, so that the
+ * arguments are not even evaluated when the level is disabled.
+ */
+class Log {
+public:
+	/* Sets the most verbose level written at runtime (default is SFE_LOG_WARNING)
+	 */
+	static void setLevel(int level);
+
+	static bool isEnabled(int level)
+	{
+		return level <= s_level;
+	}
+
+	/* Formats the printf-like message and queues it for writing
+	 */
+	static void write(int level, const char *format, ...)
+#ifdef __GNUC__
+		__attribute__((format(printf, 2, 3)))
+#endif
+		;
+
+private:
+	static int s_level;
+};
+
+} // namespace sfe
+
+#define SFE_LOG(level, ...)\
+do { if (sfe::Log::isEnabled(level)) sfe::Log::write(level, __VA_ARGS__); } while (0)
+
+#if SFE_COMPILED_LOG_LEVEL >= SFE_LOG_ERROR
+	#define LOG_ERROR(...) SFE_LOG(SFE_LOG_ERROR, __VA_ARGS__)
+#else
+	#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if SFE_COMPILED_LOG_LEVEL >= SFE_LOG_WARNING
+	#define LOG_WARNING(...) SFE_LOG(SFE_LOG_WARNING, __VA_ARGS__)
+#else
+	#define LOG_WARNING(...) do {} while (0)
+#endif
+
+#if SFE_COMPILED_LOG_LEVEL >= SFE_LOG_INFO
+	#define LOG_INFO(...) SFE_LOG(SFE_LOG_INFO, __VA_ARGS__)
+#else
+	#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if SFE_COMPILED_LOG_LEVEL >= SFE_LOG_DEBUG
+	#define LOG_DEBUG(...) SFE_LOG(SFE_LOG_DEBUG, __VA_ARGS__)
+#else
+	#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif
@@ -33,22 +33,107 @@ extern "C"
 #include "Condition.hpp"
 #include "Movie_video.hpp"
 #include "Movie_audio.hpp"
+#include "DecodePool.hpp"
+#include "FrameBufferPool.hpp"
+#include "Atomic.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
+#include "Thumbnailer.hpp"
+#include "SideDemuxer.hpp"
 #include "utils.hpp"
 #include <SFML/Graphics.hpp>
-#include <iostream>
 
 #define IFAUDIO(sequence) { if (m_hasAudio) { sequence; } }
 #define IFVIDEO(sequence) { if (m_hasVideo) { sequence; } }
 
 namespace sfe {
+	
+	// Amount of Movie instances, the pooled frame buffers are freed with the last one
+	static volatile long g_movieCount = 0;
 
-	static bool g_usesDebugMessages = false;
-
+	Movie::Statistics::Statistics(void) :
+	decodedFrames(0),
+	displayedFrames(0),
+	droppedFrames(0),
+	lateFrames(0),
+	decodingTimes(),
+	conversionTimes(),
+	videoQueuedBytes(0),
+	videoQueuedDuration(sf::Time::Zero),
+	audioQueuedBytes(0),
+	audioQueuedDuration(sf::Time::Zero),
+	bytesRead(0),
+	audioUnderruns(0),
+	audioPrematureEnds(0),
+	audioVideoOffset(sf::Time::Zero)
+	{
+	}
+	
+	Movie::TrackInfo::TrackInfo(void) :
+	language(),
+	title(),
+	codec(),
+	size(0, 0),
+	channelCount(0),
+	sampleRate(0),
+	isDefault(false)
+	{
+	}
+	
+	static Movie::TrackInfo describeStream(AVStream *stream)
+	{
+		Movie::TrackInfo info;
+		AVDictionaryEntry *language = av_dict_get(stream->metadata, "language", NULL, 0);
+		AVDictionaryEntry *title = av_dict_get(stream->metadata, "title", NULL, 0);
+		
+		if (language)
+			info.language = language->value;
+		
+		if (title)
+			info.title = title->value;
+		
+		info.codec = avcodec_get_name(stream->codec->codec_id);
+		info.size = sf::Vector2i(stream->codec->width, stream->codec->height);
+		info.channelCount = stream->codec->channels;
+		info.sampleRate = stream->codec->sample_rate;
+		info.isDefault = (stream->disposition & AV_DISPOSITION_DEFAULT) != 0;
+		
+		return info;
+	}
+	
 	Movie::Movie(void) :
 	m_avFormatCtx(NULL),
+	m_bytesRead(0),
+	m_statsMutex(),
 	m_hasVideo(false),
 	m_hasAudio(false),
 	m_eofReached(false),
+	m_isDecodingOffline(false),
+	m_needsRewind(false),
+	m_isStepping(false),
+	m_isReverse(false),
+	m_isPlayingReverse(false),
+	m_reverseStart(sf::Time::Zero),
+	m_loop(false),
+	m_loopStart(sf::Time::Zero),
+	m_loopEnd(sf::Time::Zero),
+	m_loopMutex(),
+	m_isSkippingToLoopStart(false),
+	m_packetsSinceLoop(0),
+	m_previewLevel(0),
+	m_demuxBudget(32 * 1024 * 1024),
+	m_isVideoQueueFull(false),
+	m_isAudioQueueFull(false),
+	m_lastVideoDts(AV_NOPTS_VALUE),
+	m_lastAudioDts(AV_NOPTS_VALUE),
+	m_canUseSideDemuxer(true),
+	m_sideDemuxer(new SideDemuxer()),
+	m_videoStreams(),
+	m_audioStreams(),
+	m_videoTrack(-1),
+	m_audioTrack(-1),
+	m_isVideoEnabled(true),
+	m_isAudioEnabled(true),
 	m_stopMutex(),
 	m_readerMutex(),
 	m_watchThread(&Movie::watch, this),
@@ -58,10 +143,13 @@ namespace sfe {
 	m_duration(sf::Time::Zero),
 	m_overallTimer(),
 	m_progressAtPause(sf::Time::Zero),
+	m_playbackSpeed(1.f),
+	m_clockMutex(),
 	
 	m_video(new Movie_video(*this)),
 	m_audio(new Movie_audio(*this))
 	{
+		atomicFetchAndAdd(&g_movieCount, 1);
 	}
 
 	Movie::~Movie(void)
@@ -70,10 +158,15 @@ namespace sfe {
 		close();
 		delete m_video;
 		delete m_audio;
+		delete m_sideDemuxer;
 		
 		m_shouldStopCond->invalidate();
 		
 		delete m_shouldStopCond;
+		
+		// Nothing will reuse the buffers until another movie is created
+		if (atomicFetchAndAdd(&g_movieCount, -1) == 1)
+			FrameBufferPool::purge();
 	}
 
 	bool Movie::openFromFile(const std::string& filename)
@@ -86,7 +179,7 @@ namespace sfe {
 		close();
 		
 		// Load all the decoders
-		av_register_all();
+		initializeFFmpeg();
 
 		// Open the movie file
 		err = avformat_open_input(&m_avFormatCtx, filename.c_str(), NULL, NULL);
@@ -107,13 +200,20 @@ namespace sfe {
 			return false;
 		}
 
-		if (usesDebugMessages())
+		if (Log::isEnabled(SFE_LOG_DEBUG))
 			// Output the movie informations
 			av_dump_format(m_avFormatCtx, 0, filename.c_str(), 0);
+		
+		if (m_avFormatCtx->duration != AV_NOPTS_VALUE)
+			setDuration(sf::microseconds(m_avFormatCtx->duration));
+		else
+			LOG_DEBUG("Movie::openFromFile() - warning: unable to retrieve the movie duration");
 
 		// Perform the audio and video loading
-		m_hasVideo = m_video->initialize();
-		m_hasAudio = m_audio->initialize();
+		findTracks();
+		m_hasVideo = m_isVideoEnabled && m_videoTrack >= 0 && m_video->initialize(m_videoStreams[m_videoTrack]);
+		m_hasAudio = m_isAudioEnabled && m_audioTrack >= 0 && m_audio->initialize(m_audioStreams[m_audioTrack]);
+		discardUnselectedStreams();
 		
 		if (m_hasVideo)
 		{
@@ -121,8 +221,7 @@ namespace sfe {
 			
 			if (!preloaded) // Loading first frames failed
 			{
-				if (sfe::Movie::usesDebugMessages())
-					std::cerr << "Movie::OpenFromFile() - Movie_video::PreLoad() failed.\n";
+				LOG_DEBUG("Movie::OpenFromFile() - Movie_video::PreLoad() failed.");
 			}
 		}
 		
@@ -133,7 +232,44 @@ namespace sfe {
 	{
 		if (m_status != Playing)
 		{
-			if (m_hasAudio)
+			if (m_status == Stopped && m_isReverse && m_hasVideo)
+			{
+				if (!startReverse())
+					return;
+			}
+			else
+			{
+				// Start from the frame reached by stepping
+				if (m_isStepping)
+				{
+					sf::Time position = m_video->getDisplayedPosition();
+					
+					if (!preroll(position, sf::Time::Zero, sf::Time::Zero))
+					{
+						LOG_ERROR("Movie::play() - unable to start the playback from %.3fs", position.asSeconds());
+						return;
+					}
+				}
+				
+				// Go back to the beginning if frames were pulled with nextFrame()
+				// or extractFrame()
+				if (m_isDecodingOffline || m_needsRewind)
+				{
+					m_isDecodingOffline = false;
+					m_needsRewind = false;
+					rewind();
+					IFVIDEO(m_video->preLoad());
+				}
+			}
+			
+			// The sound is not played backward. Prerolled sound starts from the preroll
+			// position as soon as its first buffer is queued, there is nothing to wait for
+			if (m_hasAudio && !m_isPlayingReverse && m_status == Stopped && m_audio->isPrerolled())
+			{
+				m_audio->play();
+				m_progressAtPause = m_audio->getPlayingOffset();
+			}
+			else if (m_hasAudio && !m_isPlayingReverse)
 			{
 				sf::Time startOffset = m_audio->getPlayingOffset();
 				sf::Clock timer;
@@ -146,7 +282,7 @@ namespace sfe {
 				// Note: this is a workaround for SFML issue #201
 				// Audio initialization may silently fail and audio won't start playing
 				if (timer.getElapsedTime() >= sf::seconds(5))
-					std::cerr << "*** warning: Movie::play() - no audio progress for 5 sec, giving up on syncing" << std::endl;
+					LOG_WARNING("Movie::play() - no audio progress for 5 sec, giving up on syncing");
 				
 				m_progressAtPause = m_audio->getPlayingOffset();
 			}
@@ -154,8 +290,7 @@ namespace sfe {
 			m_overallTimer.restart();
 			IFVIDEO(m_video->play());
 			
-			if (usesDebugMessages())
-				printWithTime("did start movie timer");
+			LOG_DEBUG("did start movie timer");
 			
 			// Don't restart watch thread if we're resuming
 			if (m_status != Paused)
@@ -169,6 +304,55 @@ namespace sfe {
 		}
 	}
 
+	bool Movie::preroll(sf::Time position, sf::Time videoPrefill, sf::Time audioPrefill)
+	{
+		if (!m_hasVideo && !m_hasAudio)
+			return false;
+		
+		if (m_status != Stopped)
+		{
+			LOG_WARNING("Movie::preroll() - the movie must be stopped");
+			return false;
+		}
+		
+		// Drop everything read so far
+		rewind();
+		m_isDecodingOffline = false;
+		m_needsRewind = false;
+		
+		int streamID = m_hasVideo ? m_video->getStreamID() : m_audio->getStreamID();
+		AVStream *stream = m_avFormatCtx->streams[streamID];
+		int64_t timestamp = av_rescale_q(position.asMicroseconds(), AV_TIME_BASE_Q, stream->time_base);
+		
+		if (stream->start_time != AV_NOPTS_VALUE)
+			timestamp += stream->start_time;
+		
+		if (av_seek_frame(m_avFormatCtx, streamID, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+		{
+			LOG_ERROR("Movie::preroll() - unable to seek to %.3fs", position.asSeconds());
+			m_needsRewind = true;
+			return false;
+		}
+		
+		bool success = true;
+		
+		// Video first: the audio packets read meanwhile are kept for the audio preroll
+		if (m_hasVideo && !m_video->preroll(position, videoPrefill))
+			success = false;
+		
+		// The sound may end before the images, this is only an error without video
+		if (m_hasAudio && !m_audio->preroll(position, audioPrefill) && !m_hasVideo)
+			success = false;
+		
+		// Used as reference clock when there is no audio
+		m_progressAtPause = position;
+		
+		if (!success)
+			m_needsRewind = true;
+		
+		return success;
+	}
+	
 	void Movie::pause(void)
 	{
 		if (m_status == Playing)
@@ -179,7 +363,7 @@ namespace sfe {
 			// to the audio's one)
 			// NB: Calling Pause()/Play() is the only way to resynchronize
 			// audio and video when audio gets late for now.
-			if (hasAudioTrack())
+			if (hasAudioTrack() && !m_isPlayingReverse)
 			{
 				m_progressAtPause = m_audio->getPlayingOffset();
 				//std::cout << "synch according to audio track=" << m_progressAtPause << std::endl;
@@ -187,7 +371,7 @@ namespace sfe {
 			else
 			{
 				//std::cout << "synch according to progrAtPse=" << m_progressAtPause << " + elapsdTme=" << m_overallTimer.GetElapsedTime() << std::endl;
-				m_progressAtPause += m_overallTimer.getElapsedTime();
+				m_progressAtPause = getPlaybackClock();
 			}
 			
 			m_status = Paused;
@@ -198,6 +382,13 @@ namespace sfe {
 
 	void Movie::stop(void)
 	{
+		// Leave the frame reached by stepping, play() starts from the beginning again
+		if (m_isStepping)
+		{
+			m_isStepping = false;
+			m_needsRewind = true;
+		}
+		
 		internalStop(false);
 	}
 	
@@ -213,7 +404,11 @@ namespace sfe {
 			IFVIDEO(m_video->stop());
 			
 			m_progressAtPause = sf::Time::Zero;
+			m_isPlayingReverse = false;
 			setEofReached(false);
+			m_isSkippingToLoopStart = false;
+			m_packetsSinceLoop = 0;
+			resetSideReading();
 			m_shouldStopCond->invalidate();
 			
 			if (!calledFromWatchThread)
@@ -221,6 +416,229 @@ namespace sfe {
 		}
 	}
 
+	void Movie::rewind(void)
+	{
+		IFAUDIO(m_audio->stop());
+		IFVIDEO(m_video->stop());
+		setEofReached(false);
+		m_isSkippingToLoopStart = false;
+		m_packetsSinceLoop = 0;
+		m_isStepping = false;
+		resetSideReading();
+	}
+	
+	bool Movie::nextFrame(VideoFrame& frame)
+	{
+		if (!m_hasVideo)
+			return false;
+		
+		if (m_status != Stopped)
+		{
+			LOG_WARNING("Movie::nextFrame() - the movie must be stopped");
+			return false;
+		}
+		
+		// Start over, the first frames have been consumed by the preloading
+		if (!m_isDecodingOffline)
+		{
+			rewind();
+			m_isDecodingOffline = true;
+			m_needsRewind = false;
+		}
+		
+		return m_video->decodeNextFrame(frame);
+	}
+	
+	void Movie::setReversePlayback(bool flag)
+	{
+		if (flag == m_isReverse)
+			return;
+		
+		m_isReverse = flag;
+		
+		// Go on in the other direction from the displayed frame
+		if (m_status != Stopped && m_hasVideo)
+		{
+			bool wasPlaying = (m_status == Playing);
+			
+			internalStop(false);
+			m_isStepping = true;
+			
+			if (wasPlaying)
+				play();
+		}
+	}
+	
+	bool Movie::isReversePlayback(void) const
+	{
+		return m_isReverse;
+	}
+	
+	bool Movie::startReverse(void)
+	{
+		// From the displayed frame, or from the end when the movie is at its beginning
+		sf::Time position = m_duration;
+		
+		if (m_isStepping)
+			position = m_video->getDisplayedPosition();
+		else if (m_progressAtPause > sf::Time::Zero)
+			position = m_progressAtPause;
+		
+		rewind();
+		m_isDecodingOffline = false;
+		m_needsRewind = false;
+		
+		if (!m_video->startReverse(m_avFormatCtx->filename, position))
+		{
+			LOG_ERROR("Movie::play() - unable to start the reverse playback");
+			m_needsRewind = true;
+			return false;
+		}
+		
+		// The playback clock counts the time elapsed since this position
+		m_isPlayingReverse = true;
+		m_reverseStart = position;
+		m_progressAtPause = sf::Time::Zero;
+		return true;
+	}
+	
+	void Movie::setPlaybackSpeed(float speed)
+	{
+		if (speed < 0.25f)
+			speed = 0.25f;
+		else if (speed > 8.f)
+			speed = 8.f;
+		
+		// The time played so far keeps the previous speed
+		{
+			sf::Lock l(m_clockMutex);
+			
+			if (m_status == Playing)
+			{
+				m_progressAtPause += m_overallTimer.restart() * m_playbackSpeed;
+			}
+			
+			m_playbackSpeed = speed;
+		}
+		
+		IFAUDIO(m_audio->setSpeed(speed));
+	}
+	
+	float Movie::getPlaybackSpeed(void) const
+	{
+		return m_playbackSpeed;
+	}
+	
+	bool Movie::stepForward(void)
+	{
+		return step(false);
+	}
+	
+	bool Movie::stepBackward(void)
+	{
+		return step(true);
+	}
+	
+	void Movie::setStepCacheSize(std::size_t bytes)
+	{
+		m_video->setStepCacheCapacity(bytes);
+	}
+	
+	std::size_t Movie::getStepCacheSize(void) const
+	{
+		return m_video->getStepCacheCapacity();
+	}
+	
+	bool Movie::scrub(sf::Time position, unsigned previewLevel)
+	{
+		if (!m_hasVideo)
+			return false;
+		
+		if (m_status != Stopped)
+			internalStop(false);
+		
+		m_isDecodingOffline = false;
+		m_needsRewind = false;
+		m_isStepping = true;
+		
+		if (position > m_duration)
+			position = m_duration;
+		
+		return seekForStep(position) && m_video->scrub(previewLevel);
+	}
+	
+	bool Movie::step(bool backward)
+	{
+		if (!m_hasVideo)
+			return false;
+		
+		if (m_status == Playing)
+		{
+			LOG_WARNING("Movie::%s() - the movie must be paused or stopped", backward ? "stepBackward" : "stepForward");
+			return false;
+		}
+		
+		// Stopped movies display the first frame, or the prerolled one
+		sf::Time position = m_progressAtPause;
+		
+		if (m_status == Paused || m_isStepping)
+			position = m_video->getDisplayedPosition();
+		
+		if (m_status == Paused)
+			internalStop(false);
+		
+		m_isDecodingOffline = false;
+		m_needsRewind = false;
+		m_isStepping = true;
+		
+		return m_video->step(position, backward);
+	}
+	
+	bool Movie::seekForStep(sf::Time position)
+	{
+		// Stopping the audio drops the audio packets read so far, it moves the
+		// read position too thus it comes first
+		IFAUDIO(m_audio->stop());
+		setEofReached(false);
+		resetSideReading();
+		
+		return m_video->seek(position);
+	}
+	
+	bool Movie::extractFrame(sf::Time time, sf::Vector2u size, sf::Image& image)
+	{
+		if (!m_hasVideo)
+			return false;
+		
+		if (m_status != Stopped)
+		{
+			LOG_WARNING("Movie::extractFrame() - the movie must be stopped");
+			return false;
+		}
+		
+		m_isDecodingOffline = false;
+		m_needsRewind = true;
+		
+		return m_video->extractFrame(time, size, image);
+	}
+	
+	bool Movie::extractFrame(const std::string& filename, sf::Time time, sf::Vector2u size, sf::Image& image)
+	{
+		return Thumbnailer::extract(filename, time, size, image);
+	}
+	
+	bool Movie::extractFrames(const std::string& filename, const std::vector<sf::Time>& times,
+							  sf::Vector2u size, std::vector<sf::Image>& images)
+	{
+		return Thumbnailer::extract(filename, times, size, images);
+	}
+	
+	bool Movie::extractFrames(const std::string& filename, unsigned count,
+							  sf::Vector2u size, std::vector<sf::Image>& images)
+	{
+		return Thumbnailer::extract(filename, count, size, images);
+	}
+	
 	bool Movie::hasVideoTrack(void) const
 	{
 		return m_hasVideo;
@@ -248,6 +666,223 @@ namespace sfe {
 		return m_duration;
 	}
 
+	std::vector<Movie::TrackInfo> Movie::getVideoTracks(void) const
+	{
+		std::vector<TrackInfo> tracks;
+		
+		for (unsigned i = 0; i < m_videoStreams.size(); i++)
+			tracks.push_back(describeStream(m_avFormatCtx->streams[m_videoStreams[i]]));
+		
+		return tracks;
+	}
+	
+	std::vector<Movie::TrackInfo> Movie::getAudioTracks(void) const
+	{
+		std::vector<TrackInfo> tracks;
+		
+		for (unsigned i = 0; i < m_audioStreams.size(); i++)
+			tracks.push_back(describeStream(m_avFormatCtx->streams[m_audioStreams[i]]));
+		
+		return tracks;
+	}
+	
+	bool Movie::selectVideoTrack(unsigned index)
+	{
+		if (index >= m_videoStreams.size())
+		{
+			LOG_ERROR("Movie::selectVideoTrack() - there is no video track %u", index);
+			return false;
+		}
+		
+		if (m_status != Stopped)
+		{
+			LOG_ERROR("Movie::selectVideoTrack() - the movie must be stopped");
+			return false;
+		}
+		
+		if (m_hasVideo && m_videoTrack == (int)index)
+			return true;
+		
+		// Opened once the video is enabled
+		if (!m_isVideoEnabled)
+		{
+			m_videoTrack = index;
+			return true;
+		}
+		
+		IFVIDEO(m_video->close());
+		m_hasVideo = m_video->initialize(m_videoStreams[index]);
+		m_videoTrack = m_hasVideo ? index : -1;
+		
+		restartAfterTrackChange();
+		return m_hasVideo;
+	}
+	
+	bool Movie::selectAudioTrack(unsigned index)
+	{
+		if (index >= m_audioStreams.size())
+		{
+			LOG_ERROR("Movie::selectAudioTrack() - there is no audio track %u", index);
+			return false;
+		}
+		
+		if (m_status != Stopped)
+		{
+			LOG_ERROR("Movie::selectAudioTrack() - the movie must be stopped");
+			return false;
+		}
+		
+		if (m_hasAudio && m_audioTrack == (int)index)
+			return true;
+		
+		// Opened once the audio is enabled
+		if (!m_isAudioEnabled)
+		{
+			m_audioTrack = index;
+			return true;
+		}
+		
+		IFAUDIO(m_audio->close());
+		m_hasAudio = m_audio->initialize(m_audioStreams[index]);
+		m_audioTrack = m_hasAudio ? index : -1;
+		
+		restartAfterTrackChange();
+		return m_hasAudio;
+	}
+	
+	int Movie::getSelectedVideoTrack(void) const
+	{
+		return m_videoTrack;
+	}
+	
+	int Movie::getSelectedAudioTrack(void) const
+	{
+		return m_audioTrack;
+	}
+	
+	void Movie::setVideoEnabled(bool flag)
+	{
+		m_isVideoEnabled = flag;
+		
+		if (!m_avFormatCtx || m_videoTrack < 0 || flag == m_hasVideo)
+			return;
+		
+		if (m_status != Stopped)
+		{
+			LOG_WARNING("Movie::setVideoEnabled() - the movie is not stopped, the change applies to the next opened file");
+			return;
+		}
+		
+		if (flag)
+		{
+			m_hasVideo = m_video->initialize(m_videoStreams[m_videoTrack]);
+		}
+		else
+		{
+			m_video->close();
+			m_hasVideo = false;
+		}
+		
+		restartAfterTrackChange();
+	}
+	
+	bool Movie::isVideoEnabled(void) const
+	{
+		return m_isVideoEnabled;
+	}
+	
+	void Movie::setAudioEnabled(bool flag)
+	{
+		m_isAudioEnabled = flag;
+		
+		if (!m_avFormatCtx || m_audioTrack < 0 || flag == m_hasAudio)
+			return;
+		
+		if (m_status != Stopped)
+		{
+			LOG_WARNING("Movie::setAudioEnabled() - the movie is not stopped, the change applies to the next opened file");
+			return;
+		}
+		
+		if (flag)
+		{
+			m_hasAudio = m_audio->initialize(m_audioStreams[m_audioTrack]);
+		}
+		else
+		{
+			m_audio->close();
+			m_hasAudio = false;
+		}
+		
+		restartAfterTrackChange();
+	}
+	
+	bool Movie::isAudioEnabled(void) const
+	{
+		return m_isAudioEnabled;
+	}
+	
+	void Movie::findTracks(void)
+	{
+		int bestVideoStream = av_find_best_stream(m_avFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+		int bestAudioStream = av_find_best_stream(m_avFormatCtx, AVMEDIA_TYPE_AUDIO, -1, bestVideoStream, NULL, 0);
+		
+		for (unsigned i = 0; i < m_avFormatCtx->nb_streams; i++)
+		{
+			AVStream *stream = m_avFormatCtx->streams[i];
+			
+			// Cover pictures are not movies
+			if (stream->codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+				!(stream->disposition & AV_DISPOSITION_ATTACHED_PIC))
+			{
+				if ((int)i == bestVideoStream)
+					m_videoTrack = m_videoStreams.size();
+				
+				m_videoStreams.push_back(i);
+			}
+			else if (stream->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+			{
+				if ((int)i == bestAudioStream)
+					m_audioTrack = m_audioStreams.size();
+				
+				m_audioStreams.push_back(i);
+			}
+		}
+		
+		if (m_videoTrack < 0 && !m_videoStreams.empty())
+			m_videoTrack = 0;
+		
+		if (m_audioTrack < 0 && !m_audioStreams.empty())
+			m_audioTrack = 0;
+		
+		LOG_DEBUG("Movie::findTracks() - %u video and %u audio tracks", (unsigned)m_videoStreams.size(), (unsigned)m_audioStreams.size());
+	}
+	
+	void Movie::discardUnselectedStreams(void)
+	{
+		// Let the demuxer skip the packets nobody decodes instead of reading
+		// them and freeing them in saveFrame()
+		for (unsigned i = 0; i < m_avFormatCtx->nb_streams; i++)
+		{
+			bool isSelected = (m_hasVideo && (int)i == m_video->getStreamID()) ||
+							  (m_hasAudio && (int)i == m_audio->getStreamID());
+			
+			m_avFormatCtx->streams[i]->discard = isSelected ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+		}
+	}
+	
+	void Movie::restartAfterTrackChange(void)
+	{
+		discardUnselectedStreams();
+		
+		// The packets queued so far don't include the new track, read again
+		// from the beginning as openFromFile() does
+		m_isDecodingOffline = false;
+		m_needsRewind = false;
+		rewind();
+		IFVIDEO(m_video->preLoad());
+	}
+	
 	sf::Vector2i Movie::getSize(void) const
 	{
 		return m_video->getSize();
@@ -333,17 +968,128 @@ namespace sfe {
 	}*/
 
 	sf::Time Movie::getPlayingOffset() const
+	{
+		if (m_isPlayingReverse)
+		{
+			sf::Time reverseOffset = m_reverseStart - getPlaybackClock();
+			return (reverseOffset > sf::Time::Zero) ? reverseOffset : sf::Time::Zero;
+		}
+		
+		sf::Time offset = getPlaybackClock();
+		bool loop;
+		sf::Time loopStart;
+		sf::Time loopEnd;
+		
+		{
+			sf::Lock l(m_loopMutex);
+			loop = m_loop;
+			loopStart = m_loopStart;
+			loopEnd = getLoopEnd();
+		}
+		
+		// The playback clock keeps going on across loops
+		if (loop && offset >= loopEnd && loopEnd > loopStart)
+		{
+			sf::Int64 length = (loopEnd - loopStart).asMicroseconds();
+			offset = loopStart + sf::microseconds((offset - loopEnd).asMicroseconds() % length);
+		}
+		
+		return offset;
+	}
+	
+	sf::Time Movie::getPlaybackClock(void) const
 	{
 		sf::Time offset = sf::Time::Zero;
+		sf::Lock l(m_clockMutex);
 
 		if (m_status == Playing)
-			offset = m_progressAtPause + m_overallTimer.getElapsedTime();
+			offset = m_progressAtPause + m_overallTimer.getElapsedTime() * m_playbackSpeed;
 		else
 			offset = m_progressAtPause;
 
 		return offset;
 	}
+	
+	void Movie::setLoop(bool flag)
+	{
+		sf::Lock l(m_readerMutex);
+		sf::Lock l2(m_loopMutex);
+		m_loop = flag;
+	}
+	
+	bool Movie::getLoop(void) const
+	{
+		sf::Lock l(m_loopMutex);
+		return m_loop;
+	}
+	
+	void Movie::setLoopRange(sf::Time start, sf::Time end)
+	{
+		sf::Lock l(m_readerMutex);
+		sf::Lock l2(m_loopMutex);
+		m_loopStart = start;
+		m_loopEnd = end;
+	}
+	
+	sf::Time Movie::getLoopStart(void) const
+	{
+		sf::Lock l(m_loopMutex);
+		return m_loopStart;
+	}
+	
+	sf::Time Movie::getLoopEnd(void) const
+	{
+		sf::Lock l(m_loopMutex);
+		return (m_loopEnd > sf::Time::Zero) ? m_loopEnd : m_duration;
+	}
+	
+	void Movie::setPreviewLevel(unsigned level)
+	{
+		m_previewLevel = (level > 3) ? 3 : level;
+	}
+	
+	unsigned Movie::getPreviewLevel(void) const
+	{
+		return m_previewLevel;
+	}
+	
+	void Movie::setDemuxMemoryBudget(std::size_t bytes)
+	{
+		sf::Lock l(m_readerMutex);
+		m_demuxBudget = bytes;
+	}
+	
+	std::size_t Movie::getDemuxMemoryBudget(void) const
+	{
+		return m_demuxBudget;
+	}
 
+	sf::Time Movie::getNextFrameTime(void) const
+	{
+		if (!m_hasVideo || m_status != Playing)
+			return sf::microseconds(-1);
+		
+		return m_video->getNextFrameTime();
+	}
+	
+	sf::Time Movie::getNextFrameTime(const std::vector<Movie *>& movies)
+	{
+		sf::Time nextFrameTime = sf::microseconds(-1);
+		
+		for (unsigned i = 0; i < movies.size(); i++)
+		{
+			sf::Time movieTime = movies[i]->getNextFrameTime();
+			
+			if (movieTime >= sf::Time::Zero &&
+				(nextFrameTime < sf::Time::Zero || movieTime < nextFrameTime))
+			{
+				nextFrameTime = movieTime;
+			}
+		}
+		
+		return nextFrameTime;
+	}
+	
 	const sf::Texture& Movie::getCurrentFrame(void) const
 	{
 		static sf::Texture emptyTexture;
@@ -354,11 +1100,42 @@ namespace sfe {
 			return emptyTexture;
 	}
 
+	void Movie::setFrameSink(FrameSink *sink, bool renderFrames)
+	{
+		m_video->setFrameSink(sink, renderFrames);
+	}
+	
+	void Movie::useTracing(bool flag)
+	{
+		Trace::setEnabled(flag);
+	}
+	
+	bool Movie::saveTrace(const std::string& filename)
+	{
+		return Trace::save(filename);
+	}
+	
+	Movie::Statistics Movie::getStatistics(void) const
+	{
+		Statistics stats;
+		
+		IFVIDEO(m_video->fillStatistics(stats));
+		IFAUDIO(m_audio->fillStatistics(stats));
+		
+		if (m_hasVideo && m_hasAudio)
+			stats.audioVideoOffset = m_video->getDisplayedPosition() - m_audio->getPlayingOffset();
+		
+		sf::Lock l(m_statsMutex);
+		stats.bytesRead = m_bytesRead;
+		
+		return stats;
+	}
+	
 	void Movie::useDebugMessages(bool flag)
 	{
-		g_usesDebugMessages = flag;
+		Log::setLevel(flag ? SFE_LOG_DEBUG : SFE_LOG_WARNING);
 
-		if (g_usesDebugMessages)
+		if (flag)
 			av_log_set_level(AV_LOG_VERBOSE);
 		else
 			av_log_set_level(AV_LOG_ERROR);
@@ -367,11 +1144,8 @@ namespace sfe {
 	
 	void Movie::draw(sf::RenderTarget& target, sf::RenderStates states) const
 	{
-		if (usesDebugMessages())
-		{
-			printWithTime("audio playing : " + ftostr(m_audio->getPlayingOffset().asSeconds()) + "s");
-			printWithTime("reference playing : " + ftostr(getPlayingOffset().asSeconds()) + "s");
-		}
+		LOG_DEBUG("audio playing : %.3fs", m_audio->getPlayingOffset().asSeconds());
+		LOG_DEBUG("reference playing : %.3fs", getPlayingOffset().asSeconds());
 		
 		states.transform *= getTransform();
 		m_video->draw(target, states);
@@ -382,13 +1156,13 @@ namespace sfe {
 		char buffer[4096] = {0};
 
 		if (/*err != AVERROR_NOENT &&*/ 0 == av_strerror(err, buffer, sizeof(buffer)))
-			std::cerr << "FFmpeg error: " << buffer << std::endl;
+			LOG_ERROR("FFmpeg error: %s", buffer);
 		else
 		{
 		    if (fallbackMessage.length())
-                std::cerr << "FFmpeg error: " << fallbackMessage << std::endl;
+                LOG_ERROR("FFmpeg error: %s", fallbackMessage.c_str());
             else
-                std::cerr << "FFmpeg error: unable to retrieve the error message (and no fallback message set)" << std::endl;
+                LOG_ERROR("FFmpeg error: unable to retrieve the error message (and no fallback message set)");
 		}
 	}
 
@@ -396,15 +1170,30 @@ namespace sfe {
 	{
 		IFVIDEO(m_video->close());
 		IFAUDIO(m_audio->close());
+		resetSideReading();
+		m_canUseSideDemuxer = true;
+		m_videoStreams.clear();
+		m_audioStreams.clear();
+		m_videoTrack = -1;
+		m_audioTrack = -1;
 
 		if (m_avFormatCtx)
 			avformat_close_input(&m_avFormatCtx);
 		m_hasAudio = false;
 		m_hasVideo = false;
 		m_eofReached = false;
+		m_isDecodingOffline = false;
+		m_needsRewind = false;
+		m_isStepping = false;
+		m_isPlayingReverse = false;
+		m_isSkippingToLoopStart = false;
+		m_packetsSinceLoop = 0;
 		m_status = Stopped;
 		m_duration = sf::Time::Zero;
 		m_progressAtPause = sf::Time::Zero;
+		
+		sf::Lock l(m_statsMutex);
+		m_bytesRead = 0;
 	}
 
 	AVFormatContext *Movie::getAVFormatContext(void)
@@ -430,9 +1219,14 @@ namespace sfe {
 	bool Movie::readFrameAndQueue(void)
 	{
 		// Avoid reading from different threads at the same time
-		sf::Lock l(m_readerMutex);
+		{
+			TRACE_SCOPE("wait demuxer");
+			m_readerMutex.lock();
+		}
+		
 		bool flag = true;
 		AVPacket *pkt = NULL;
+		bool isLooping = m_loop && !m_isDecodingOffline && !m_isStepping;
 		
 		// check we're not at eof
 		if (getEofReached())
@@ -443,32 +1237,241 @@ namespace sfe {
 			pkt = (AVPacket *)av_malloc(sizeof(*pkt));
 			av_init_packet(pkt);
 			
-			int res = av_read_frame(getAVFormatContext(), pkt);
+			int res;
+			{
+				TRACE_SCOPE("av_read_frame");
+				res = av_read_frame(getAVFormatContext(), pkt);
+			}
+			
+			bool isPastLoopEnd = false;
+			
+			if (res >= 0 && isLooping && m_loopEnd > sf::Time::Zero)
+			{
+				isPastLoopEnd = getPacketTime(pkt) >= m_loopEnd;
+			}
 			
 			// check we didn't reach eof right now
-			if (res < 0)
+			if (res < 0 || isPastLoopEnd)
+			{
+				if (res >= 0)
+					av_free_packet(pkt);
+				av_free(pkt);
+				
+				if (!isLooping || !loopReadPosition())
+				{
+					setEofReached(true);
+					flag = false;
+				}
+			}
+			else if (isReadBySideDemuxer(pkt))
+			{
+				av_free_packet(pkt);
+				av_free(pkt);
+			}
+			else if (m_isSkippingToLoopStart && m_hasAudio &&
+					 pkt->stream_index == m_audio->getStreamID() &&
+					 getPacketTime(pkt) < m_loopStart)
 			{
-				setEofReached(true);
-				flag = false;
+				// The seek went back to the keyframe preceding the loop start,
+				// the sound before the loop start must not be heard
 				av_free_packet(pkt);
 				av_free(pkt);
 			}
 			else
 			{
+				m_statsMutex.lock();
+				m_bytesRead += pkt->size;
+				m_statsMutex.unlock();
+				
+				if (m_hasAudio && pkt->stream_index == m_audio->getStreamID())
+					m_isSkippingToLoopStart = false;
+				
 				// When a frame has been read, save it
 				if (!saveFrame(pkt))
 				{
-					if (Movie::usesDebugMessages())
-						std::cerr << "Movie::ReadFrameAndQueue() - did read unknown packet type" << std::endl;
+					LOG_DEBUG("Movie::ReadFrameAndQueue() - did read unknown packet type");
 					av_free_packet(pkt);
 					av_free(pkt);
 				}
+				else
+				{
+					m_packetsSinceLoop++;
+				}
 			}
 		}
 		
+		m_readerMutex.unlock();
+		return flag;
+	}
+	
+	bool Movie::readStreamPacket(int streamID)
+	{
+		{
+			TRACE_SCOPE("wait demuxer");
+			m_readerMutex.lock();
+		}
+		
+		bool flag;
+		
+		// Reading on with the main demuxer would queue more packets of a stream
+		// whose queue is already full, read the wanted stream on its own instead
+		if (m_demuxBudget && m_canUseSideDemuxer && !m_loop && !m_isDecodingOffline &&
+			isOtherQueueFull(streamID))
+		{
+			flag = readSidePacket(streamID);
+		}
+		else
+		{
+			flag = readFrameAndQueue();
+		}
+		
+		m_readerMutex.unlock();
 		return flag;
 	}
 	
+	bool Movie::readSidePacket(int streamID)
+	{
+		// The main demuxer must catch up with the packets of the other stream
+		// before they can be told apart from the ones it already queued
+		if (m_sideDemuxer->isOpen() && m_sideDemuxer->getStreamID() != streamID)
+			return readFrameAndQueue();
+		
+		if (!m_sideDemuxer->isOpen())
+		{
+			bool isVideo = m_hasVideo && streamID == m_video->getStreamID();
+			sf::Int64 lastDts = isVideo ? m_lastVideoDts : m_lastAudioDts;
+			
+			LOG_DEBUG("Movie::readSidePacket() - %s queue full, reading the %s stream through a second demuxer",
+					  isVideo ? "audio" : "video", isVideo ? "video" : "audio");
+			
+			if (!m_sideDemuxer->open(m_avFormatCtx->filename, streamID, lastDts))
+			{
+				LOG_WARNING("Movie::readSidePacket() - unable to open a second demuxer, the packet queues may exceed the memory budget");
+				m_canUseSideDemuxer = false;
+				return readFrameAndQueue();
+			}
+		}
+		
+		AVPacket *pkt = m_sideDemuxer->read();
+		
+		// The main demuxer still has to reach the end of the file
+		if (!pkt)
+			return false;
+		
+		m_statsMutex.lock();
+		m_bytesRead += pkt->size;
+		m_statsMutex.unlock();
+		
+		if (!saveFrame(pkt))
+		{
+			av_free_packet(pkt);
+			av_free(pkt);
+		}
+		
+		return true;
+	}
+	
+	bool Movie::isOtherQueueFull(int streamID)
+	{
+		// A queue is full from the high watermark until it drains down to the low
+		// one, so that the readers are not switched back and forth on every packet
+		std::size_t highWatermark = m_demuxBudget / 4 * 3;
+		std::size_t lowWatermark = m_demuxBudget / 4;
+		
+		if (m_hasVideo && streamID != m_video->getStreamID())
+		{
+			sf::Uint64 queuedBytes = m_video->getQueuedBytes();
+			m_isVideoQueueFull = m_isVideoQueueFull ? queuedBytes > lowWatermark : queuedBytes >= highWatermark;
+			return m_isVideoQueueFull;
+		}
+		
+		if (m_hasAudio && streamID != m_audio->getStreamID())
+		{
+			sf::Uint64 queuedBytes = m_audio->currentlyPendingDataLength();
+			m_isAudioQueueFull = m_isAudioQueueFull ? queuedBytes > lowWatermark : queuedBytes >= highWatermark;
+			return m_isAudioQueueFull;
+		}
+		
+		return false;
+	}
+	
+	bool Movie::isReadBySideDemuxer(AVPacket *packet)
+	{
+		if (packet->stream_index != m_sideDemuxer->getStreamID())
+			return false;
+		
+		if (packet->dts != AV_NOPTS_VALUE && packet->dts <= m_sideDemuxer->getLastDts())
+			return true;
+		
+		// The main demuxer caught up, the next packets are new
+		LOG_DEBUG("Movie::isReadBySideDemuxer() - main demuxer caught up, closing the second demuxer");
+		m_sideDemuxer->close();
+		return false;
+	}
+	
+	void Movie::resetSideReading(void)
+	{
+		sf::Lock l(m_readerMutex);
+		
+		m_sideDemuxer->close();
+		m_isVideoQueueFull = false;
+		m_isAudioQueueFull = false;
+		m_lastVideoDts = AV_NOPTS_VALUE;
+		m_lastAudioDts = AV_NOPTS_VALUE;
+	}
+	
+	bool Movie::loopReadPosition(void)
+	{
+		// Nothing was read since the previous loop, the range is empty
+		if (m_packetsSinceLoop == 0)
+		{
+			LOG_WARNING("Movie::loopReadPosition() - no packet in the loop range, stopping the loop");
+			return false;
+		}
+		
+		int streamID = m_hasVideo ? m_video->getStreamID() : m_audio->getStreamID();
+		AVStream *stream = m_avFormatCtx->streams[streamID];
+		int64_t timestamp = av_rescale_q(m_loopStart.asMicroseconds(), AV_TIME_BASE_Q, stream->time_base);
+		
+		if (stream->start_time != AV_NOPTS_VALUE)
+			timestamp += stream->start_time;
+		
+		if (av_seek_frame(m_avFormatCtx, streamID, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+		{
+			LOG_ERROR("Movie::loopReadPosition() - av_seek_frame() error");
+			return false;
+		}
+		
+		// Let the decoders output what they still hold for the end of the
+		// loop, then reset them before the packets of the loop start
+		IFVIDEO(m_video->pushFrame(allocFlushPacket()));
+		IFAUDIO(m_audio->pushFrame(allocFlushPacket()));
+		
+		m_isSkippingToLoopStart = m_loopStart > sf::Time::Zero;
+		m_packetsSinceLoop = 0;
+		resetSideReading();
+		
+		LOG_DEBUG("Movie::loopReadPosition() - looping to %.3fs", m_loopStart.asSeconds());
+		return true;
+	}
+	
+	sf::Time Movie::getPacketTime(AVPacket *packet) const
+	{
+		AVStream *stream = m_avFormatCtx->streams[packet->stream_index];
+		
+		// Decoding order matters here, so that the frames referenced by the
+		// last frames of the loop are kept
+		int64_t timestamp = (packet->dts != AV_NOPTS_VALUE) ? packet->dts : packet->pts;
+		
+		if (timestamp == AV_NOPTS_VALUE)
+			return sf::Time::Zero;
+		
+		if (stream->start_time != AV_NOPTS_VALUE)
+			timestamp -= stream->start_time;
+		
+		return sf::microseconds(av_rescale_q(timestamp, stream->time_base, AV_TIME_BASE_Q));
+	}
+	
 	bool Movie::saveFrame(AVPacket *frame)
 	{
 		bool saved = false;
@@ -476,20 +1479,33 @@ namespace sfe {
 		if (m_hasAudio && frame->stream_index == m_audio->getStreamID())
 		{
 			// If it was an audio frame...
-			m_audio->pushFrame(frame);
+			if (m_isDecodingOffline)
+			{
+				// Nobody will consume it
+				av_free_packet(frame);
+				av_free(frame);
+			}
+			else
+			{
+				if (frame->dts != AV_NOPTS_VALUE)
+					m_lastAudioDts = frame->dts;
+				
+				m_audio->pushFrame(frame);
+			}
 			saved = true;
 		}
 		else if (m_hasVideo && frame->stream_index == m_video->getStreamID())
 		{
 			// If it was a video frame...
+			if (frame->dts != AV_NOPTS_VALUE)
+				m_lastVideoDts = frame->dts;
+			
 			m_video->pushFrame(frame);
 			saved = true;
 		}
 		else
 		{
-			if (usesDebugMessages())
-				std::cerr << "Movie::SaveFrame() - unknown packet stream id ("
-				<< frame->stream_index << ")\n";
+			LOG_DEBUG("Movie::SaveFrame() - unknown packet stream id (%d)", frame->stream_index);
 		}
 
 		return saved;
@@ -497,7 +1513,27 @@ namespace sfe {
 
 	bool Movie::usesDebugMessages(void)
 	{
-		return g_usesDebugMessages;
+		return Log::isEnabled(SFE_LOG_DEBUG);
+	}
+	
+	void Movie::useSharedDecodePool(bool flag)
+	{
+		DecodePool::setEnabled(flag);
+	}
+	
+	bool Movie::usesSharedDecodePool(void)
+	{
+		return DecodePool::isEnabled();
+	}
+	
+	void Movie::setFrameBufferPoolCapacity(std::size_t bytes)
+	{
+		FrameBufferPool::setCapacity(bytes);
+	}
+	
+	std::size_t Movie::getFrameBufferPoolCapacity(void)
+	{
+		return FrameBufferPool::getCapacity();
 	}
 	
 	void Movie::starvation(void)
@@ -505,7 +1541,7 @@ namespace sfe {
 		bool audioStarvation = true;
 		bool videoStarvation = true;
 		
-		IFAUDIO(audioStarvation = m_audio->isStarving());
+		IFAUDIO(audioStarvation = m_isPlayingReverse || m_audio->isStarving());
 		IFVIDEO(videoStarvation = m_video->isStarving());
 		
 		// No mode audio or video data to read
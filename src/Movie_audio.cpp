@@ -24,9 +24,11 @@
 
 #include "Movie_audio.hpp"
 #include <sfeMovie/Movie.hpp>
-#include <iostream>
 #include <cassert>
+#include <algorithm>
 #include "utils.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
 
 #define AUDIO_BUFSIZ AVCODEC_MAX_AUDIO_FRAME_SIZE // 192000 bytes, 1 second of 48kHz 32bit audio
 
@@ -41,6 +43,19 @@ namespace sfe {
 	m_streamID(-1),
 	m_buffer(NULL),
 	m_pendingDataLength(0),
+	m_pendingDataDuration(0),
+	m_underrunCount(0),
+	m_prematureEndCount(0),
+	m_outputClock(),
+	m_outputEnd(sf::Time::Zero),
+	m_prerollSamples(),
+	m_prerollOffset(0),
+	m_startOffset(sf::Time::Zero),
+	m_speed(1.f),
+	m_outputOrigin(sf::Time::Zero),
+	m_speedMutex(),
+	m_stretcher(),
+	m_stretchedSamples(),
 	m_channelsCount(0),
 	m_sampleRate(0),
 	m_isStarving(false)
@@ -52,16 +67,12 @@ namespace sfe {
 	{
 	}
 	
-	bool Movie_audio::initialize(void)
+	bool Movie_audio::initialize(int streamID)
 	{
 		int err;
 		
-		// Find the audio stream among the differents streams
-		for (int i = 0; -1 == m_streamID && i < m_parent.getAVFormatContext()->nb_streams; i++) 
-		{ 
-			if (m_parent.getAVFormatContext()->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO) 
-				m_streamID = i;
-		}
+		// The stream is chosen by Movie, see Movie::selectAudioTrack()
+		m_streamID = streamID;
 		
 		if (-1 == m_streamID)
 			return false;
@@ -77,7 +88,7 @@ namespace sfe {
 		m_codec = avcodec_find_decoder(m_codecCtx->codec_id); 
 		if (NULL == m_codec) 
 		{
-			std::cerr << "Movie_audio::Initialize() - could not find any audio decoder for this audio format" << std::endl;
+			LOG_ERROR("Movie_audio::Initialize() - could not find any audio decoder for this audio format");
 			close();
 			return false; 
 		} 
@@ -86,7 +97,7 @@ namespace sfe {
 		err = avcodec_open2(m_codecCtx, m_codec, NULL);
 		if (err < 0)
 		{
-			std::cerr << "Movie_audio::Initialize() - unable to load the audio decoder for this audio format" << std::endl;
+			LOG_ERROR("Movie_audio::Initialize() - unable to load the audio decoder for this audio format");
 			close();
 			return false;
 		}
@@ -94,7 +105,7 @@ namespace sfe {
 		m_buffer = (sf::Int16 *)av_malloc(AUDIO_BUFSIZ);
 		if (!m_buffer)
 		{
-			std::cerr << "Movie_audio::Initialize() - memory allocation error" << std::endl;
+			LOG_ERROR("Movie_audio::Initialize() - memory allocation error");
 			close();
 			return false;
 		}
@@ -105,17 +116,31 @@ namespace sfe {
 		
 		// Initialize the sf::SoundStream
 		sf::SoundStream::initialize(m_channelsCount, m_sampleRate);
+		m_stretcher.initialize(m_channelsCount, m_sampleRate);
+		m_speed = m_parent.getPlaybackSpeed();
 		
 		return true;
 	}
 	
+	void Movie_audio::play(void)
+	{
+		// The sound stream doesn't ask for data while stopped or paused, this time
+		// is not a lack of sound
+		{
+			sf::Lock l(m_packetListMutex);
+			m_outputEnd = sf::Time::Zero;
+		}
+		
+		sf::SoundStream::play();
+	}
+	
 	void Movie_audio::stop(void)
 	{
 		sf::SoundStream::stop();
 		
 		if (av_seek_frame(m_parent.getAVFormatContext(), m_streamID, 0, AVSEEK_FLAG_BACKWARD) < 0)
 		{
-			std::cerr << "Movie_audio::Stop() - av_seek_frame() error" << std::endl;
+			LOG_ERROR("Movie_audio::Stop() - av_seek_frame() error");
 		}
 		avcodec_flush_buffers(m_codecCtx);
 		
@@ -123,6 +148,11 @@ namespace sfe {
 			popFrame();
 		}
 		
+		m_prerollSamples.clear();
+		m_prerollOffset = 0;
+		m_startOffset = sf::Time::Zero;
+		m_outputOrigin = sf::Time::Zero;
+		m_stretcher.clear();
 		m_isStarving = false;
 	}
 	
@@ -144,6 +174,104 @@ namespace sfe {
 		m_channelsCount = 0;
 		m_sampleRate = 0;
 		m_isStarving = false;
+		m_underrunCount = 0;
+		m_prematureEndCount = 0;
+		m_prerollSamples.clear();
+		m_prerollOffset = 0;
+		m_startOffset = sf::Time::Zero;
+		m_outputOrigin = sf::Time::Zero;
+		m_stretcher.clear();
+	}
+	
+	sf::Time Movie_audio::getPlayingOffset(void) const
+	{
+		sf::Lock l(m_speedMutex);
+		return m_startOffset + (sf::SoundStream::getPlayingOffset() - m_outputOrigin) * m_speed;
+	}
+	
+	void Movie_audio::setSpeed(float speed)
+	{
+		// The offset reached so far was played at the previous speed. The samples
+		// already queued in the sound stream are not stretched again, thus the
+		// offset is a bit off until pause() resynchronizes the playback
+		sf::Time outputOffset = sf::SoundStream::getPlayingOffset();
+		sf::Lock l(m_speedMutex);
+		
+		m_startOffset += (outputOffset - m_outputOrigin) * m_speed;
+		m_outputOrigin = outputOffset;
+		m_speed = speed;
+	}
+	
+	bool Movie_audio::preroll(sf::Time position, sf::Time prefill)
+	{
+		AVStream *stream = m_parent.getAVFormatContext()->streams[m_streamID];
+		unsigned wantedSamples = prefill.asSeconds() * m_sampleRate * m_channelsCount;
+		
+		m_prerollSamples.clear();
+		m_prerollOffset = 0;
+		m_startOffset = position;
+		m_outputOrigin = sf::Time::Zero;
+		m_stretcher.clear();
+		
+		// Decode up to the position at least, so that the sound preceding it is not heard
+		while (m_prerollSamples.size() < wantedSamples || m_prerollSamples.empty())
+		{
+			while (!hasPendingDecodableData() && m_parent.readStreamPacket(m_streamID));
+			
+			if (!hasPendingDecodableData())
+				break;
+			
+			AVPacket *packet = frontFrame();
+			int frameSize = AUDIO_BUFSIZ;
+			
+			if (isFlushPacket(packet))
+			{
+				avcodec_flush_buffers(m_codecCtx);
+				popFrame();
+				continue;
+			}
+
+			int res;
+			{
+				TRACE_SCOPE("avcodec_decode_audio3");
+				res = avcodec_decode_audio3(m_codecCtx, m_buffer, &frameSize, packet);
+			}
+			
+			if (res >= 0 && frameSize > 0)
+			{
+				unsigned sampleCount = frameSize / sizeof(sf::Int16);
+				unsigned skippedSamples = 0;
+				
+				// Drop the samples preceding the wanted position
+				if (packet->pts != AV_NOPTS_VALUE)
+				{
+					int64_t pts = packet->pts;
+					
+					if (stream->start_time != AV_NOPTS_VALUE)
+						pts -= stream->start_time;
+					
+					sf::Time packetTime = sf::microseconds(av_rescale_q(pts, stream->time_base, AV_TIME_BASE_Q));
+					
+					if (packetTime < position)
+					{
+						sf::Int64 skippedFrames = (position - packetTime).asMicroseconds() * m_sampleRate / 1000000;
+						skippedSamples = std::min((sf::Int64)sampleCount, skippedFrames * m_channelsCount);
+					}
+				}
+				
+				m_prerollSamples.insert(m_prerollSamples.end(), m_buffer + skippedSamples, m_buffer + sampleCount);
+			}
+			
+			popFrame();
+		}
+		
+		// Nothing was decoded when the sound ends before the position
+		return !m_prerollSamples.empty();
+	}
+	
+	bool Movie_audio::isPrerolled(void) const
+	{
+		return m_prerollOffset == 0 && !m_prerollSamples.empty();
 	}
 	
 	void Movie_audio::setPlayingOffset(sf::Time time)
@@ -158,7 +286,7 @@ namespace sfe {
 		int res = av_seek_frame(m_parent.getAVFormatContext(), m_streamID, avTime, AVSEEK_FLAG_BACKWARD);
 		
 		if (res < 0)
-			std::cerr << "Movie_audio::SetPlayingOffset() - av_seek_frame() failed" << std::endl;
+			LOG_ERROR("Movie_audio::SetPlayingOffset() - av_seek_frame() failed");
 		else
 		{
 			while (m_packetList.size()) {
@@ -185,8 +313,8 @@ namespace sfe {
 			return !m_parent.getEofReached();
 		
 		// Read the movie file until we get an audio frame
-		while (currentlyPendingDataLength() < AUDIO_BUFSIZ && !m_parent.getEofReached())
-			m_parent.readFrameAndQueue();
+		while (currentlyPendingDataLength() < AUDIO_BUFSIZ && !m_parent.getEofReached() &&
+			   m_parent.readStreamPacket(m_streamID));
 		
 		return (currentlyPendingDataLength() != 0);
 	}
@@ -204,6 +332,7 @@ namespace sfe {
 	
 	void Movie_audio::decodeFrontFrame(Chunk& sfBuffer)
 	{
+		TRACE_SCOPE("audio chunk decoding");
 		unsigned audioPacketOffset = 0;
 		int res = 1;
 		sfBuffer.samples = NULL;
@@ -224,8 +353,7 @@ namespace sfe {
 			{
 				if (!readChunk())
 				{
-					if (Movie::usesDebugMessages())
-						std::cerr << "Movie_audio::DecodeFrontFrame() - no frame currently available for decoding. Aborting decoding sequence." << std::endl;
+					LOG_DEBUG("Movie_audio::DecodeFrontFrame() - no frame currently available for decoding. Aborting decoding sequence.");
 					return;
 				}
 			}
@@ -234,14 +362,25 @@ namespace sfe {
 			// Get the front audio packet
 			audioPacket = frontFrame();
 			
+			// The next packets come from the loop start
+			if (isFlushPacket(audioPacket))
+			{
+				avcodec_flush_buffers(m_codecCtx);
+				popFrame();
+				continue;
+			}
+			
 			// Decode it
-			res = avcodec_decode_audio3(m_codecCtx,
-										(sf::Int16 *)((char *)m_buffer + audioPacketOffset),
-										&frame_size, audioPacket);
+			{
+				TRACE_SCOPE("avcodec_decode_audio3");
+				res = avcodec_decode_audio3(m_codecCtx,
+											(sf::Int16 *)((char *)m_buffer + audioPacketOffset),
+											&frame_size, audioPacket);
+			}
 			
 			if (res < 0)
 			{
-				std::cerr << "Movie_audio::DecodeFrontFrame() - an error occured while decoding the audio frame" << std::endl;
+				LOG_ERROR("Movie_audio::DecodeFrontFrame() - an error occured while decoding the audio frame");
 			}
 			else
 			{
@@ -250,9 +389,9 @@ namespace sfe {
 				if (m_codecCtx->sample_fmt != AV_SAMPLE_FMT_S16)
 				{
 					// Never happened to me for now, which is fine
-					if (Movie::usesDebugMessages())
+					if (Log::isEnabled(SFE_LOG_DEBUG))
 					{
-						ONCE(std::cerr << "Movie_audio::DecodeFrontFrame() - audio format for the current movie is not signed 16 bits and sfe::Movie does not support audio resampling yet" << std::endl);
+						ONCE(LOG_DEBUG("Movie_audio::DecodeFrontFrame() - audio format for the current movie is not signed 16 bits and sfe::Movie does not support audio resampling yet"));
 					}
 				}
 				
@@ -269,6 +408,7 @@ namespace sfe {
 		sf::Lock l(m_packetListMutex);
 		m_packetList.push(pkt);
 		m_pendingDataLength += pkt->size;
+		m_pendingDataDuration += pkt->duration;
 	}
 	
 	void Movie_audio::popFrame(void)
@@ -279,6 +419,7 @@ namespace sfe {
 		{
 			AVPacket *pkt = m_packetList.front();
 			m_pendingDataLength -= pkt->size;
+			m_pendingDataDuration -= pkt->duration;
 			m_packetList.pop();
 			av_free_packet(pkt);
 			av_free(pkt);
@@ -293,9 +434,80 @@ namespace sfe {
 		return m_packetList.front();
 	}
 	
+	void Movie_audio::fillStatistics(Movie::Statistics& stats)
+	{
+		sf::Lock l(m_packetListMutex);
+		AVRational tb = m_parent.getAVFormatContext()->streams[m_streamID]->time_base;
+		
+		stats.audioQueuedBytes = m_pendingDataLength;
+		stats.audioQueuedDuration = sf::microseconds(av_rescale_q(m_pendingDataDuration, tb, AV_TIME_BASE_Q));
+		stats.audioUnderruns = m_underrunCount;
+		stats.audioPrematureEnds = m_prematureEndCount;
+	}
+	
 	bool Movie_audio::onGetData(Chunk& buffer)
     {
 		bool flag = true;
+		float speed;
+		Trace::setThreadName("sfeMovie audio");
+		
+		{
+			sf::Lock l(m_speedMutex);
+			speed = m_speed;
+		}
+		
+		if (speed == 1.f && m_stretcher.isEmpty())
+			flag = getSamples(buffer);
+		else
+			flag = stretchSamples(buffer, speed);
+		
+		if (flag)
+		{
+			sf::Time now = m_outputClock.getElapsedTime();
+			sf::Lock l(m_packetListMutex);
+			
+			// The sound stream checks its buffers every 10 ms
+			if (m_outputEnd > sf::Time::Zero && now > m_outputEnd + sf::milliseconds(10))
+				m_underrunCount++;
+			
+			m_outputEnd = std::max(now, m_outputEnd) + sf::seconds((float)buffer.sampleCount / (m_sampleRate * m_channelsCount));
+		}
+		else
+		{
+			// Returning false ends the sound stream: when this happens before the
+			// end of the file, the rest of the audio is lost
+			if (!m_parent.getEofReached())
+			{
+				sf::Lock l(m_packetListMutex);
+				m_prematureEndCount++;
+			}
+			
+			m_isStarving = true;
+			m_parent.starvation();
+		}
+		
+        return flag;
+    }
+	
+	bool Movie_audio::getSamples(Chunk& buffer)
+	{
+		bool flag = true;
+		
+		// Give the samples decoded by preroll() first
+		if (m_prerollOffset < m_prerollSamples.size())
+		{
+			buffer.samples = &m_prerollSamples[m_prerollOffset];
+			buffer.sampleCount = std::min((size_t)m_sampleRate * m_channelsCount, m_prerollSamples.size() - m_prerollOffset);
+			m_prerollOffset += buffer.sampleCount;
+			return true;
+		}
+		
+		// The last preroll chunk has been queued by now
+		if (!m_prerollSamples.empty())
+		{
+			m_prerollSamples.clear();
+			m_prerollOffset = 0;
+		}
         
 		if (!hasPendingDecodableData())
 			flag = readChunk();
@@ -309,19 +521,50 @@ namespace sfe {
 				flag = false;
 			}
 			else {
-				if (Movie::usesDebugMessages())
-					printWithTime("did load an audio chunk");
+				LOG_DEBUG("did load an audio chunk");
 			}
 		}
 		
-		if (!flag)
+		return flag;
+	}
+	
+	bool Movie_audio::stretchSamples(Chunk& buffer, float speed)
+	{
+		// About as long as the decoded chunks once played
+		std::size_t wantedCount = m_sampleRate * m_channelsCount / 4;
+		m_stretchedSamples.clear();
+		
+		if (speed == 1.f)
 		{
-			m_isStarving = true;
-			m_parent.starvation();
+			// Back to the normal speed, give what was kept for stretching first
+			m_stretcher.flush(m_stretchedSamples);
+		}
+		else
+		{
+			bool canRead = true;
+			
+			while (m_stretchedSamples.size() < wantedCount && canRead)
+			{
+				if (!m_stretcher.process(speed, m_stretchedSamples))
+				{
+					Chunk decoded;
+					canRead = getSamples(decoded);
+					
+					if (canRead)
+						m_stretcher.push(decoded.samples, decoded.sampleCount);
+				}
+			}
+			
+			// The end of the stream is too short for a whole sequence
+			if (!canRead && m_parent.getEofReached())
+				m_stretcher.flush(m_stretchedSamples);
 		}
 		
-        return flag;
-    }
+		buffer.samples = m_stretchedSamples.empty() ? NULL : &m_stretchedSamples[0];
+		buffer.sampleCount = m_stretchedSamples.size();
+		
+		return buffer.sampleCount > 0;
+	}
 
 	
 	void Movie_audio::onSeek(sf::Time timeOffset)
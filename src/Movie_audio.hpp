@@ -33,8 +33,11 @@ extern "C"
 #include <libswscale/swscale.h>
 }
 #include <queue>
+#include <vector>
 #include <SFML/System.hpp>
 #include <SFML/Audio.hpp>
+#include <sfeMovie/Movie.hpp>
+#include "TimeStretcher.hpp"
 
 namespace sfe {
 	class Movie;
@@ -44,20 +47,23 @@ namespace sfe {
 		~Movie_audio(void);
 		
 		// -------------------------- Audio methods ----------------------------
-		bool initialize(void);
+		bool initialize(int streamID);
 		void stop(void);
 		void close(void);
 		
-		using sf::SoundStream::play;
+		void play(void);
 		using sf::SoundStream::pause;
 		using sf::SoundStream::setVolume;
 		using sf::SoundStream::getVolume;
 		using sf::SoundStream::getSampleRate;
 		using sf::SoundStream::getChannelCount;
 		//using sf::SoundStream::SetPlayingOffset;
-		using sf::SoundStream::getPlayingOffset;
 		
+		sf::Time getPlayingOffset(void) const;
 		void setPlayingOffset(sf::Time time);
+		bool preroll(sf::Time position, sf::Time prefill);
+		bool isPrerolled(void) const;
+		void setSpeed(float speed);
 		
 		int getStreamID();
 		bool isStarving(void);
@@ -69,11 +75,15 @@ namespace sfe {
 		void pushFrame(AVPacket *pkt);
 		void popFrame(void);
 		AVPacket *frontFrame(void);
+		void fillStatistics(Movie::Statistics& stats);
 		
 		bool onGetData(Chunk& Data);
 		void onSeek(sf::Time timeOffset);
 		
 	private:
+		bool getSamples(Chunk& buffer);
+		bool stretchSamples(Chunk& buffer, float speed);
+		
 		// ------------------------- Audio attributes --------------------------
 		Movie& m_parent;
 		
@@ -86,6 +96,23 @@ namespace sfe {
 		int m_streamID;
 		sf::Int16 *m_buffer; // Buffer used to store the current audio data chunk
 		unsigned m_pendingDataLength;
+		int64_t m_pendingDataDuration; // Duration of the packets in m_packetList, in stream time base
+		sf::Uint64 m_underrunCount;
+		sf::Uint64 m_prematureEndCount;
+		sf::Clock m_outputClock;
+		sf::Time m_outputEnd;		// m_outputClock time when the sound given so far will have been played, Zero when unknown
+		
+		// Samples decoded by preroll(), given to the sound stream before anything else
+		std::vector<sf::Int16> m_prerollSamples;
+		unsigned m_prerollOffset;	// Index of the first sample not given yet
+		sf::Time m_startOffset;		// Position in the movie when the sound stream was at m_outputOrigin
+		
+		// Samples given to the sound stream are stretched when the speed is not 1
+		float m_speed;
+		sf::Time m_outputOrigin;	// Sound stream offset when the speed last changed
+		mutable sf::Mutex m_speedMutex;
+		TimeStretcher m_stretcher;
+		std::vector<sf::Int16> m_stretchedSamples;
 		
 		unsigned m_channelsCount;
 		unsigned m_sampleRate;
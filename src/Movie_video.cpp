@@ -28,10 +28,14 @@
 
 #include "Movie_audio.hpp"
 #include "utils.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
+#include "FrameBuffer.hpp"
+#include "Thumbnailer.hpp"
 #include <SFML/Config.hpp>
 #include <SFML/Graphics.hpp>
-#include <iostream>
 #include <cassert>
+#include <algorithm>
 
 #define NTSC_FRAMERATE 29.97f
 
@@ -46,9 +50,18 @@ namespace sfe {
 	m_rawFrame(NULL),
 	m_backRGBAFrame(NULL),
 	m_frontRGBAFrame(NULL),
+	m_frontRGBAPictureBuffer(NULL),
+	m_backRGBAPictureBuffer(NULL),
 	m_streamID(-1),
-	m_pictureBuffer(NULL), // Buffer used to convert image from pixel matrix to simple array
 	m_swsCtx(NULL),
+	m_bufferSize(0, 0),
+	m_bufferPixelFormat(PIX_FMT_NONE),
+	m_usesOwnBuffers(false),
+	
+	// Decoded frames output
+	m_frameSink(NULL),
+	m_frameSinkMutex(),
+	m_renderFrames(true),
 	
 	// Packets' queueing stuff
 	m_packetList(),
@@ -57,6 +70,9 @@ namespace sfe {
 	// Decoding thread
 	m_decodeThread(&Movie_video::decode, this),	// Does video decoding
 	m_running(),
+	m_decodeTask(*this),
+	m_decodeTaskState(0),
+	m_usesDecodePool(false),
 	
 	// Image swaping
 	m_imageSwapMutex(),
@@ -72,25 +88,81 @@ namespace sfe {
 	m_decodingTime(sf::Time::Zero),
 	m_timer(),
 	m_runThread(false),
-	m_size(0, 0)
+	m_isSkippingToLoopStart(false),
+	m_frameSkipLevel(0),
+	m_lastFrameTime(sf::microseconds(-1)),
+	m_size(0, 0),
+	
+	// Frame stepping
+	m_stepCache(),
+	m_stepDecoderTime(sf::Time::Zero),
+	m_isStepDecoderValid(false),
+	
+	// Reverse playback
+	m_reverseDecoder(),
+	m_isReversing(false),
+	m_backFrameTime(sf::Time::Zero),
+	
+	// Scrubbing
+	m_isScrubbing(false),
+	m_scrubPacketTime(AV_NOPTS_VALUE),
+	m_scrubLevel(0),
+	m_scrubRGBAFrame(NULL),
+	m_scrubPictureBuffer(NULL),
+	m_scrubSwsCtx(NULL),
+	m_scrubTex(),
+	m_scrubSprite(),
+	
+	// Statistics
+	m_statsMutex(),
+	m_decodedFrames(0),
+	m_displayedFrames(0),
+	m_droppedFrames(0),
+	m_lateFrames(0),
+	m_decodingTimes(),
+	m_conversionTimes(),
+	m_pendingPacketBytes(0),
+	m_pendingPacketDuration(0),
+	m_frontFrameTime(sf::Time::Zero)
 	{
 		
 	}
 	
 	Movie_video::~Movie_video(void)
 	{
+		releaseBuffers();
 	}
 	
-	bool Movie_video::initialize(void)
+	void Movie_video::releaseBuffers(void)
+	{
+		if (m_rawFrame)
+			avcodec_free_frame(&m_rawFrame);
+		
+		if (m_frontRGBAFrame)
+			free_picture(m_frontRGBAFrame, m_frontRGBAPictureBuffer);
+		
+		if (m_backRGBAFrame)
+			free_picture(m_backRGBAFrame, m_backRGBAPictureBuffer);
+		
+		if (m_swsCtx)
+			sws_freeContext(m_swsCtx), m_swsCtx = NULL;
+		
+		if (m_scrubRGBAFrame)
+			free_picture(m_scrubRGBAFrame, m_scrubPictureBuffer);
+		
+		if (m_scrubSwsCtx)
+			sws_freeContext(m_scrubSwsCtx), m_scrubSwsCtx = NULL;
+		
+		m_bufferSize = sf::Vector2i(0, 0);
+		m_bufferPixelFormat = PIX_FMT_NONE;
+	}
+	
+	bool Movie_video::initialize(int streamID)
 	{
 		int err;
 		
-		// Find the video stream among the differents streams
-		for (int i = 0; -1 == m_streamID && i < m_parent.getAVFormatContext()->nb_streams; i++)
-		{
-			if (m_parent.getAVFormatContext()->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
-				m_streamID = i;
-		}
+		// The stream is chosen by Movie, see Movie::selectVideoTrack()
+		m_streamID = streamID;
 		
 		// If no video stream found...
 		if (-1 == m_streamID)
@@ -103,7 +175,7 @@ namespace sfe {
 		m_codecCtx = m_parent.getAVFormatContext()->streams[m_streamID]->codec;
 		if (!m_codecCtx)
 		{
-			std::cerr << "Movie_video::initialize() - unable to get the video codec context" << std::endl;
+			LOG_ERROR("Movie_video::initialize() - unable to get the video codec context");
 			close();
 			return false;
 		}
@@ -112,34 +184,80 @@ namespace sfe {
 		m_codec = avcodec_find_decoder(m_codecCtx->codec_id);
 		if (NULL == m_codec)
 		{
-			std::cerr << "Movie_video::initialize() - could not find any video decoder for this video format" << std::endl;
+			LOG_ERROR("Movie_video::initialize() - could not find any video decoder for this video format");
 			close();
 			return false;
 		}
 		
+		// Let the decoder decode straight into our reference counted buffers, so that
+		// the decoded frames can be kept without any copy after the next decoding
+		// call (the decoder only drops its own reference). Edges are not drawn
+		// around the picture, so the buffers hold nothing but the picture
+		m_usesOwnBuffers = (m_codec->capabilities & CODEC_CAP_DR1) != 0;
+		
+		// Let the decoder do as much of the preview downscaling as it can,
+		// the remaining levels are done by the scaler
+		unsigned previewLevel = m_parent.getPreviewLevel();
+		unsigned decoderLevel = std::min(previewLevel, (unsigned)m_codec->max_lowres);
+		m_codecCtx->lowres = decoderLevel;
+		
+		if (m_usesOwnBuffers)
+		{
+			m_codecCtx->flags |= CODEC_FLAG_EMU_EDGE;
+			m_codecCtx->opaque = this;
+			m_codecCtx->get_buffer = &Movie_video::getBuffer;
+			m_codecCtx->release_buffer = &Movie_video::releaseBuffer;
+			m_codecCtx->thread_safe_callbacks = 1;
+		}
+		
 		// Load the video codec
 		err = avcodec_open2(m_codecCtx, m_codec, NULL);
 		if (err < 0)
 		{
-			std::cerr << "Movie_video::initialize() - unable to load the video decoder for this video format" << std::endl;
+			LOG_ERROR("Movie_video::initialize() - unable to load the video decoder for this video format");
 			close();
 			return false;
 		}
 		
 		
-		// Create the frame buffers
-		m_rawFrame = alloc_picture(m_codecCtx->pix_fmt, m_codecCtx->width, m_codecCtx->height, m_rawPictureBuffer);
-		m_backRGBAFrame =  alloc_picture(PIX_FMT_RGBA, m_codecCtx->width, m_codecCtx->height, m_backRGBAPictureBuffer);
-		m_frontRGBAFrame = alloc_picture(PIX_FMT_RGBA, m_codecCtx->width, m_codecCtx->height, m_frontRGBAPictureBuffer);
-		if (!m_rawFrame || !m_frontRGBAFrame || !m_backRGBAFrame)
+		// Create the frame buffers, unless the previous movie had the same format.
+		// The decoded size already includes the decoder's lowres reduction
+		unsigned scalerLevel = previewLevel - decoderLevel;
+		sf::Vector2i size(std::max(1, m_codecCtx->width >> scalerLevel),
+						  std::max(1, m_codecCtx->height >> scalerLevel));
+		
+		if (previewLevel)
 		{
-			std::cerr << "Movie_video::initialize() - allocation error" << std::endl;
-			close();
-			return false;
+			LOG_DEBUG("Movie_video::initialize() - preview level %u, %u done by the decoder, output size %dx%d",
+					  previewLevel, decoderLevel, size.x, size.y);
 		}
 		
+		bool canReuseBuffers = m_rawFrame && m_bufferSize == size && m_bufferPixelFormat == m_codecCtx->pix_fmt;
+		
+		if (!canReuseBuffers)
+		{
+			releaseBuffers();
+			
+			// The decoder sets the planes of the raw frame itself, from getBuffer()
+			// or from its internal buffers
+			m_rawFrame = avcodec_alloc_frame();
+			m_backRGBAFrame =  alloc_picture(PIX_FMT_RGBA, size.x, size.y, m_backRGBAPictureBuffer);
+			m_frontRGBAFrame = alloc_picture(PIX_FMT_RGBA, size.x, size.y, m_frontRGBAPictureBuffer);
+			if (!m_rawFrame || !m_frontRGBAFrame || !m_backRGBAFrame)
+			{
+				LOG_ERROR("Movie_video::initialize() - allocation error");
+				close();
+				return false;
+			}
+			
+			m_bufferSize = size;
+			m_bufferPixelFormat = m_codecCtx->pix_fmt;
+		}
+		
+		LOG_DEBUG("Movie_video::initialize() - %s the frame buffers", canReuseBuffers ? "reusing" : "allocated");
+		
 		// Get the video size
-		m_size = sf::Vector2i(m_codecCtx->width, m_codecCtx->height);
+		m_size = size;
 		
 		// Setup the image scaler/converter
 		int algorithm = SWS_FAST_BILINEAR;
@@ -149,7 +267,8 @@ namespace sfe {
 		if (m_size.x * m_size.y <= 500000 && m_size.x % 8 != 0)
 			algorithm |= SWS_ACCURATE_RND;
 		
-		m_swsCtx = sws_getCachedContext(NULL, m_size.x, m_size.y,
+		// Gives back m_swsCtx when it already does this conversion
+		m_swsCtx = sws_getCachedContext(m_swsCtx, m_codecCtx->width, m_codecCtx->height,
 										m_codecCtx->pix_fmt,
 										m_size.x, m_size.y,
 										PIX_FMT_RGBA,
@@ -157,14 +276,17 @@ namespace sfe {
 		
 		if (!m_swsCtx)
 		{
-			std::cerr << "Movie_video::initialize() - error with sws_getContext()" << std::endl;
+			LOG_ERROR("Movie_video::initialize() - error with sws_getContext()");
 			close();
 			return false;
 		}
 		
 		// Setup the SFML stuff
-		m_tex.create(m_size.x, m_size.y);
-		m_sprite.setTexture(m_tex);
+		if (m_tex.getSize() != sf::Vector2u(m_size.x, m_size.y))
+		{
+			m_tex.create(m_size.x, m_size.y);
+			m_sprite.setTexture(m_tex, true);
+		}
 		
 		// Get the frame time we need for this video
 		AVRational r = m_parent.getAVFormatContext()->streams[m_streamID]->avg_frame_rate;
@@ -172,8 +294,7 @@ namespace sfe {
 		if ((!r.num || !r.den) &&
             (!r2.num || !r2.den))
         {
-			if (Movie::usesDebugMessages())
-				std::cerr << "Movie_video::initialize() - unable to get the video frame rate. Using standard NTSC frame rate : 29.97 fps." << std::endl;
+			LOG_DEBUG("Movie_video::initialize() - unable to get the video frame rate. Using standard NTSC frame rate : 29.97 fps.");
             m_wantedFrameTime = sf::seconds(1.f / NTSC_FRAMERATE);
         }
         else
@@ -182,34 +303,17 @@ namespace sfe {
 			{
                 m_wantedFrameTime = sf::seconds(1.f/((float)r.num / r.den));
 				
-				if (Movie::usesDebugMessages())
-					std::cerr << "Using video framerate : " << ((float)r.num / r.den) << std::endl;
+				LOG_DEBUG("Using video framerate : %g", (float)r.num / r.den);
 			}
             else
 			{
                 m_wantedFrameTime = sf::seconds(1.f/((float)r2.num / r2.den));
 				
-				if (Movie::usesDebugMessages())
-					std::cerr << "Using video framerate : " << ((float)r2.num / r2.den) << std::endl;
+				LOG_DEBUG("Using video framerate : %g", (float)r2.num / r2.den);
 			}
         }
 		
-		if (Movie::usesDebugMessages())
-			std::cerr << "Wanted frame time is " << m_wantedFrameTime.asMilliseconds() << std::endl;
-		
-		// Get the video duration
-		if (m_parent.getAVFormatContext()->duration != AV_NOPTS_VALUE)
-		{
-            long secs, us;
-            secs = m_parent.getAVFormatContext()->duration / AV_TIME_BASE;
-            us = m_parent.getAVFormatContext()->duration % AV_TIME_BASE;
-			m_parent.setDuration(sf::seconds(secs + (float)us / AV_TIME_BASE));
-		}
-		else
-		{
-			if (Movie::usesDebugMessages())
-				std::cerr << "Movie_video::initialize() - warning: unable to retrieve the video duration" << std::endl;
-		}
+		LOG_DEBUG("Wanted frame time is %d", m_wantedFrameTime.asMilliseconds());
 		
 		return true;
 	}
@@ -224,8 +328,14 @@ namespace sfe {
 		
 		if (m_parent.getStatus() != Movie::Paused)
 		{
-			m_decodeThread.launch();
+			m_usesDecodePool = DecodePool::isEnabled();
+			
+			if (!m_usesDecodePool)
+				m_decodeThread.launch();
 		}
+		
+		if (m_usesDecodePool)
+			scheduleDecodeStep();
 	}
 	
 	void Movie_video::pause(void)
@@ -242,16 +352,37 @@ namespace sfe {
             m_runThread = false;
 			m_backImageReady.invalidate();
 			m_running.invalidate();
-			m_decodeThread.wait();
+			
+			// The decoding thread may be waiting for reversed frames
+			m_reverseDecoder.stop();
+			
+			// A step delayed until its frame deadline runs right away, and
+			// sees that the playback stopped
+			if (m_usesDecodePool)
+			{
+				DecodePool::instance().wakeUp(&m_decodeTask);
+				m_decodeTaskState.waitAndLock(0, Condition::AutoUnlock);
+			}
+			else
+				m_decodeThread.wait();
 		}
 		
 		m_displayedFrameCount = 0;
 		m_isStarving = false;
+		m_isSkippingToLoopStart = false;
+		m_stepCache.clear();
+		m_isStepDecoderValid = false;
+		m_isReversing = false;
+		m_isScrubbing = false;
+		m_scrubPacketTime = AV_NOPTS_VALUE;
+		m_frameSkipLevel = 0;
+		m_lastFrameTime = sf::microseconds(-1);
+		m_codecCtx->skip_frame = AVDISCARD_DEFAULT;
 		
 		// Go back to the beginning of the movie
 		if (av_seek_frame(m_parent.getAVFormatContext(), m_streamID, 0, AVSEEK_FLAG_BACKWARD) < 0)
 		{
-			std::cerr << "Movie_video::Stop() - av_seek_frame() error" << std::endl;
+			LOG_ERROR("Movie_video::Stop() - av_seek_frame() error");
 		}
 		avcodec_flush_buffers(m_codecCtx);
 		
@@ -267,34 +398,38 @@ namespace sfe {
 			avcodec_close(m_codecCtx), m_codecCtx = NULL;
 		
 		m_codec = NULL;
+		m_usesOwnBuffers = false;
+		m_stepCache.clear();
+		m_isStepDecoderValid = false;
 		
-		if (m_rawFrame)
-			free_picture(m_rawFrame, m_rawPictureBuffer);
-		
-		if (m_frontRGBAFrame)
-			free_picture(m_frontRGBAFrame, m_frontRGBAPictureBuffer);
-		
-		if (m_backRGBAFrame)
-			free_picture(m_backRGBAFrame, m_backRGBAPictureBuffer);
+		// The frame buffers, scaler and texture are kept for the next movie,
+		// see initialize() and releaseBuffers()
 		
 		// Free the remaining accumulated packets
 		while (m_packetList.size()) {
 			popFrame();
 		}
 		
-		if (m_swsCtx)
-			sws_freeContext(m_swsCtx), m_swsCtx = NULL;
-		
 		m_streamID = -1;
 		
-		if (m_pictureBuffer)
-			av_free(m_pictureBuffer), m_pictureBuffer = NULL;
-		
 		m_wantedFrameTime = sf::Time::Zero;
 		m_displayedFrameCount = 0;
 		m_decodingTime = sf::Time::Zero;
 		m_runThread = false;
+		m_isScrubbing = false;
+		m_scrubPacketTime = AV_NOPTS_VALUE;
+		m_frameSkipLevel = 0;
+		m_lastFrameTime = sf::microseconds(-1);
 		m_size = sf::Vector2i(0, 0);
+		
+		sf::Lock l(m_statsMutex);
+		m_decodedFrames = 0;
+		m_displayedFrames = 0;
+		m_droppedFrames = 0;
+		m_lateFrames = 0;
+		m_decodingTimes = TimeHistogram();
+		m_conversionTimes = TimeHistogram();
+		m_frontFrameTime = sf::Time::Zero;
 	}
 	
 	void Movie_video::draw(sf::RenderTarget& target, sf::RenderStates& states) const
@@ -303,18 +438,20 @@ namespace sfe {
 		
 		// Disable smoothing when the video is not scaled
 		sf::Vector2f sc = m_parent.getScale();
+		bool smooth = !(fabs(sc.x - 1.f) < 0.00001 &&
+						fabs(sc.y - 1.f) < 0.00001);
 		
-		if (fabs(sc.x - 1.f) < 0.00001 &&
-			fabs(sc.y - 1.f) < 0.00001)
+		if (m_isScrubbing)
 		{
-			m_tex.setSmooth(false);
+			// The scrubbing sprite stretches a reduced image
+			m_scrubTex.setSmooth(smooth || m_scrubLevel > 0);
+			target.draw(m_scrubSprite, states);
 		}
 		else
 		{
-			m_tex.setSmooth(true);
+			m_tex.setSmooth(smooth);
+			target.draw(m_sprite, states); // 38% on Windows
 		}
-		
-		target.draw(m_sprite, states); // 38% on Windows
 	}
 	
 	void Movie_video::ensureTextureUpdate(void) const
@@ -337,7 +474,21 @@ namespace sfe {
 				
 				// We update the texture from the front frame while the back frame
 				// is being decoded
-				m_tex.update((sf::Uint8*)m_frontRGBAFrame->data[0]);
+				{
+					TRACE_SCOPE("texture update");
+					m_tex.update((sf::Uint8*)m_frontRGBAFrame->data[0]);
+				}
+				
+				// The playback clock counts the time elapsed since the start
+				// of the reverse playback, instead of the movie position
+				sf::Time presentationTime = (sf::Int64)(m_displayedFrameCount - 1) * m_wantedFrameTime;
+				
+				m_statsMutex.lock();
+				m_displayedFrames++;
+				m_frontFrameTime = m_isReversing ? m_backFrameTime : presentationTime;
+				if (m_parent.getPlaybackClock() > presentationTime + m_wantedFrameTime)
+					m_lateFrames++;
+				m_statsMutex.unlock();
 				
 				// We unlock the decoding thread after the texture update
 				// because otherwise there are artefacts in the displayed
@@ -345,6 +496,9 @@ namespace sfe {
 				// uses the front frame), even if we could theoretically
 				// do this before the Update() call
 				m_backImageReady = 0;
+				
+				if (m_usesDecodePool)
+					scheduleDecodeStep();
 			}
 		}
 	}
@@ -359,6 +513,404 @@ namespace sfe {
 		return m_size;
 	}
 	
+	void Movie_video::fillStatistics(Movie::Statistics& stats) const
+	{
+		sf::Lock l(m_statsMutex);
+		AVRational tb = m_parent.getAVFormatContext()->streams[m_streamID]->time_base;
+		
+		stats.decodedFrames = m_decodedFrames;
+		stats.displayedFrames = m_displayedFrames;
+		stats.droppedFrames = m_droppedFrames;
+		stats.lateFrames = m_lateFrames;
+		stats.decodingTimes = m_decodingTimes;
+		stats.conversionTimes = m_conversionTimes;
+		stats.videoQueuedBytes = m_pendingPacketBytes;
+		stats.videoQueuedDuration = sf::microseconds(av_rescale_q(m_pendingPacketDuration, tb, AV_TIME_BASE_Q));
+	}
+	
+	sf::Time Movie_video::getNextFrameTime(void) const
+	{
+		// Same rule as ensureTextureUpdate(): the back image is swapped in once
+		// its presentation time is less than half a frame ahead
+		sf::Time presentationTime;
+		
+		if (m_backImageReady.value() == 1)
+			presentationTime = (sf::Int64)(m_displayedFrameCount - 1) * m_wantedFrameTime;
+		else
+			presentationTime = (sf::Int64)m_displayedFrameCount * m_wantedFrameTime;
+		
+		// The playback clock goes faster than the real time when the speed is above 1
+		sf::Time delay = presentationTime - m_wantedFrameTime / 2.f - m_parent.getPlaybackClock();
+		return std::max(delay / m_parent.getPlaybackSpeed(), sf::Time::Zero);
+	}
+	
+	sf::Uint64 Movie_video::getQueuedBytes(void) const
+	{
+		sf::Lock l(m_statsMutex);
+		return m_pendingPacketBytes;
+	}
+	
+	sf::Time Movie_video::getDisplayedPosition(void) const
+	{
+		sf::Lock l(m_statsMutex);
+		return m_frontFrameTime;
+	}
+	
+	bool Movie_video::decodeNextFrame(VideoFrame& frame)
+	{
+		if (!decodeRawFrame())
+		{
+			frame = VideoFrame();
+			return false;
+		}
+		
+		// The copy takes its own reference on the planes
+		VideoFrame decoded;
+		fillVideoFrame(decoded);
+		frame = decoded;
+		
+		return true;
+	}
+	
+	bool Movie_video::decodeRawFrame(void)
+	{
+		for (;;)
+		{
+			AVPacket flushPacket;
+			AVPacket *packet = NULL;
+			
+			if (hasPendingDecodableData() || readFrame())
+			{
+				packet = frontFrame();
+			}
+			else
+			{
+				// End of file, get the frames still delayed in the decoder
+				av_init_packet(&flushPacket);
+				flushPacket.data = NULL;
+				flushPacket.size = 0;
+				packet = &flushPacket;
+			}
+			
+			int didDecodeFrame = 0;
+			int res;
+			sf::Clock decodingTimer;
+			{
+				TRACE_SCOPE("avcodec_decode_video2");
+				res = avcodec_decode_video2(m_codecCtx, m_rawFrame, &didDecodeFrame, packet);
+			}
+			sf::Time decodingTime = decodingTimer.getElapsedTime();
+			
+			if (packet != &flushPacket)
+				popFrame();
+			
+			if (res < 0)
+			{
+				LOG_ERROR("Movie_video::decodeNextFrame() - an error occured while decoding the video frame (code %d)", res);
+			}
+			
+			m_statsMutex.lock();
+			m_decodingTimes.add(decodingTime);
+			if (res >= 0 && didDecodeFrame)
+				m_decodedFrames++;
+			m_statsMutex.unlock();
+			
+			if (res >= 0 && didDecodeFrame)
+			{
+				sendFrameToSink();
+				m_displayedFrameCount++;
+				return true;
+			}
+			
+			if (packet == &flushPacket)
+			{
+				m_isStarving = true;
+				return false;
+			}
+		}
+	}
+	
+	bool Movie_video::step(sf::Time position, bool backward)
+	{
+		sf::Time tolerance = m_wantedFrameTime / 2.f;
+		sf::Time current;
+		sf::Time target;
+		FrameBuffer *buffer = NULL;
+		
+		if (m_stepCache.find(position, tolerance, current))
+		{
+			if (backward)
+			{
+				if (m_stepCache.isFirstFrame(current))
+					return false;
+				
+				buffer = m_stepCache.findPrevious(current, target);
+			}
+			else
+			{
+				buffer = m_stepCache.findNext(current, target);
+			}
+		}
+		
+		if (!buffer && backward)
+		{
+			// Decode the group of pictures up to the current frame, the frames
+			// closest to the previous one are kept for the next steps
+			sf::Time seekPosition = position - tolerance;
+			bool isFirstFrame = false;
+			
+			if (fillStepCache(true, seekPosition, position, position - m_wantedFrameTime) &&
+				m_stepCache.find(position, tolerance, current))
+			{
+				buffer = m_stepCache.findPrevious(current, target);
+				isFirstFrame = m_stepCache.isFirstFrame(current);
+			}
+			
+			// The seek may land on the current frame when the keyframe index is
+			// not accurate, decode from the beginning then
+			if (!buffer && !isFirstFrame && seekPosition > sf::Time::Zero &&
+				fillStepCache(true, sf::Time::Zero, position, position - m_wantedFrameTime) &&
+				m_stepCache.find(position, tolerance, current))
+			{
+				buffer = m_stepCache.findPrevious(current, target);
+			}
+		}
+		else if (!buffer)
+		{
+			// Go on from the last decoded frame when it is the current one
+			bool isDecoderThere = m_isStepDecoderValid &&
+				m_stepDecoderTime >= position - tolerance &&
+				m_stepDecoderTime <= position + tolerance;
+			
+			if (fillStepCache(!isDecoderThere, position, position + m_wantedFrameTime, position + m_wantedFrameTime) &&
+				m_stepCache.find(position, tolerance, current))
+			{
+				buffer = m_stepCache.findNext(current, target);
+			}
+		}
+		
+		if (!buffer)
+			return false;
+		
+		showStepFrame(target, buffer);
+		return true;
+	}
+	
+	bool Movie_video::seek(sf::Time position)
+	{
+		while (m_packetList.size())
+			popFrame();
+		
+		avcodec_flush_buffers(m_codecCtx);
+		m_isStarving = false;
+		m_isStepDecoderValid = false;
+		
+		if (position < sf::Time::Zero)
+			position = sf::Time::Zero;
+		
+		AVStream *stream = m_parent.getAVFormatContext()->streams[m_streamID];
+		int64_t timestamp = av_rescale_q(position.asMicroseconds(), AV_TIME_BASE_Q, stream->time_base);
+		
+		if (stream->start_time != AV_NOPTS_VALUE)
+			timestamp += stream->start_time;
+		
+		if (av_seek_frame(m_parent.getAVFormatContext(), m_streamID, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+		{
+			LOG_ERROR("Movie_video::seek() - unable to seek to %.3fs", position.asSeconds());
+			return false;
+		}
+		
+		return true;
+	}
+	
+	bool Movie_video::fillStepCache(bool shouldSeek, sf::Time seekPosition, sf::Time until, sf::Time position)
+	{
+		StepCache::Link link = StepCache::UnknownPrevious;
+		sf::Time previous = m_stepDecoderTime;
+		
+		if (shouldSeek)
+		{
+			if (!m_parent.seekForStep(seekPosition))
+				return false;
+			
+			if (seekPosition <= sf::Time::Zero)
+				link = StepCache::FirstFrame;
+		}
+		else
+		{
+			link = StepCache::HasPrevious;
+		}
+		
+		// Converts every decoded frame, until the one presented at @until
+		for (;;)
+		{
+			if (!decodeRawFrame())
+			{
+				// End of the stream, the decoder has been flushed and can't go on anymore
+				m_isStepDecoderValid = false;
+				return true;
+			}
+			
+			sf::Time timestamp = getFrameTimestamp();
+			FrameBuffer *buffer = FrameBuffer::create(PIX_FMT_RGBA, m_size.x, m_size.y, 1);
+			
+			if (!buffer)
+			{
+				LOG_ERROR("Movie_video::fillStepCache() - allocation error");
+				m_isStepDecoderValid = false;
+				return false;
+			}
+			
+			sws_scale(m_swsCtx,
+					  m_rawFrame->data, m_rawFrame->linesize,
+					  0, m_codecCtx->height,
+					  buffer->data, buffer->lineSize);
+			
+			m_stepCache.insert(timestamp, buffer, link, previous, position);
+			link = StepCache::HasPrevious;
+			previous = timestamp;
+			
+			m_stepDecoderTime = timestamp;
+			m_isStepDecoderValid = true;
+			
+			if (timestamp + m_wantedFrameTime / 2.f >= until)
+				return true;
+		}
+	}
+	
+	void Movie_video::showStepFrame(sf::Time timestamp, FrameBuffer *buffer)
+	{
+		// The stepped frame replaces any preloaded one
+		m_backImageReady = 0;
+		m_isScrubbing = false;
+		m_tex.update((sf::Uint8*)buffer->data[0]);
+		m_displayedFrameCount = timestamp.asMicroseconds() / m_wantedFrameTime.asMicroseconds() + 1;
+		m_lastFrameTime = timestamp;
+		
+		sf::Lock l(m_statsMutex);
+		m_displayedFrames++;
+		m_frontFrameTime = timestamp;
+	}
+	
+	void Movie_video::setStepCacheCapacity(std::size_t bytes)
+	{
+		m_stepCache.setCapacity(bytes);
+	}
+	
+	std::size_t Movie_video::getStepCacheCapacity(void) const
+	{
+		return m_stepCache.getCapacity();
+	}
+	
+	bool Movie_video::scrub(unsigned previewLevel)
+	{
+		TRACE_SCOPE("Movie_video::scrub");
+		
+		// seek() went to the keyframe preceding the wanted position, which may
+		// be the one already displayed
+		if (!readFrame())
+		{
+			LOG_ERROR("Movie_video::scrub() - no video packet to read");
+			return false;
+		}
+		
+		AVPacket *packet = frontFrame();
+		int64_t packetTime = (packet->pts != AV_NOPTS_VALUE) ? packet->pts : packet->dts;
+		
+		if (m_isScrubbing && previewLevel == m_scrubLevel &&
+			packetTime != AV_NOPTS_VALUE && packetTime == m_scrubPacketTime)
+		{
+			return true;
+		}
+		
+		// Only the keyframe is wanted, don't decode the frames following it
+		m_codecCtx->skip_frame = AVDISCARD_NONKEY;
+		bool didDecodeFrame = decodeRawFrame();
+		m_codecCtx->skip_frame = AVDISCARD_DEFAULT;
+		avcodec_flush_buffers(m_codecCtx);
+		
+		if (!didDecodeFrame)
+		{
+			LOG_ERROR("Movie_video::scrub() - unable to decode the keyframe");
+			return false;
+		}
+		
+		sf::Vector2i size(std::max(1, m_size.x >> previewLevel),
+						  std::max(1, m_size.y >> previewLevel));
+		
+		// Keep the converted picture and the texture while the size doesn't change
+		if (!m_scrubRGBAFrame || m_scrubTex.getSize() != sf::Vector2u(size.x, size.y))
+		{
+			if (m_scrubRGBAFrame)
+				free_picture(m_scrubRGBAFrame, m_scrubPictureBuffer);
+			
+			m_scrubRGBAFrame = alloc_picture(PIX_FMT_RGBA, size.x, size.y, m_scrubPictureBuffer);
+			
+			if (!m_scrubRGBAFrame || !m_scrubTex.create(size.x, size.y))
+			{
+				LOG_ERROR("Movie_video::scrub() - allocation error");
+				return false;
+			}
+			
+			m_scrubSprite.setTexture(m_scrubTex, true);
+		}
+		
+		m_scrubSprite.setScale((float)m_size.x / size.x, (float)m_size.y / size.y);
+		
+		m_scrubSwsCtx = sws_getCachedContext(m_scrubSwsCtx, m_codecCtx->width, m_codecCtx->height,
+											 m_codecCtx->pix_fmt, size.x, size.y, PIX_FMT_RGBA,
+											 SWS_FAST_BILINEAR, NULL, NULL, NULL);
+		
+		if (!m_scrubSwsCtx)
+		{
+			LOG_ERROR("Movie_video::scrub() - error with sws_getContext()");
+			return false;
+		}
+		
+		{
+			TRACE_SCOPE("sws_scale");
+			sws_scale(m_scrubSwsCtx,
+					  m_rawFrame->data, m_rawFrame->linesize,
+					  0, m_codecCtx->height,
+					  m_scrubRGBAFrame->data, m_scrubRGBAFrame->linesize);
+		}
+		
+		m_scrubTex.update((sf::Uint8*)m_scrubRGBAFrame->data[0]);
+		
+		// The keyframe replaces any preloaded frame, play() starts from it
+		sf::Time timestamp = getFrameTimestamp();
+		m_backImageReady = 0;
+		m_isScrubbing = true;
+		m_scrubPacketTime = packetTime;
+		m_scrubLevel = previewLevel;
+		m_displayedFrameCount = timestamp.asMicroseconds() / m_wantedFrameTime.asMicroseconds() + 1;
+		m_lastFrameTime = timestamp;
+		
+		sf::Lock l(m_statsMutex);
+		m_displayedFrames++;
+		m_frontFrameTime = timestamp;
+		
+		return true;
+	}
+	
+	bool Movie_video::extractFrame(sf::Time time, sf::Vector2u size, sf::Image& image)
+	{
+		// Packets already queued come from the previous read position
+		while (m_packetList.size())
+			popFrame();
+		
+		m_isStepDecoderValid = false;
+		
+		return Thumbnailer::extract(m_parent.getAVFormatContext(), m_streamID, m_codecCtx, time, size, image);
+	}
+	
+	void Movie_video::setFrameSink(FrameSink *sink, bool renderFrames)
+	{
+		sf::Lock l(m_frameSinkMutex);
+		m_frameSink = sink;
+		m_renderFrames = renderFrames || !sink;
+	}
+	
 	sf::Time Movie_video::getWantedFrameTime(void) const
 	{
 		return m_wantedFrameTime;
@@ -366,12 +918,17 @@ namespace sfe {
 	
 	const sf::Texture& Movie_video::getCurrentFrame(void) const
 	{
+		if (m_isScrubbing)
+			return m_scrubTex;
+		
 		ensureTextureUpdate();
 		return m_tex;
 	}
 	
 	void Movie_video::decode(void)
 	{
+		Trace::setThreadName("sfeMovie video decoding");
+		
 		while (m_runThread &&
 			   m_running.waitAndLock(1, Condition::AutoUnlock) &&
 			   m_backImageReady.waitAndLock(0))
@@ -379,7 +936,7 @@ namespace sfe {
 			sf::Time waitTime;
 			bool isLate = getLateState(waitTime);
 			
-			if (loadNextImage(isLate))
+			if (loadNextImage(isLate) && m_renderFrames)
 			{
 				m_backImageReady.unlock(1);
 			}
@@ -392,9 +949,111 @@ namespace sfe {
 			{
 				m_parent.starvation();
 			}
+			else if (!m_renderFrames)
+			{
+				waitForFrameTime();
+			}
 		}
 	}
 	
+	void Movie_video::decodeStep(void)
+	{
+		sf::Time delay = sf::Time::Zero;
+		
+		// The back image may still be waiting for being displayed, in which case
+		// the next swap will schedule a new decoding step
+		if (m_runThread &&
+			m_running.value() == 1 &&
+			m_backImageReady.value() == 0 &&
+			m_backImageReady.waitAndLock(0))
+		{
+			sf::Time waitTime;
+			bool isLate = getLateState(waitTime);
+			
+			if (loadNextImage(isLate) && m_renderFrames)
+			{
+				m_backImageReady.unlock(1);
+			}
+			else
+			{
+				m_backImageReady.unlock(0);
+			}
+			
+			if (m_isStarving)
+			{
+				m_parent.starvation();
+			}
+			else if (!m_renderFrames)
+			{
+				// Don't hold the pool worker until the frame deadline,
+				// the next step is scheduled for it instead
+				delay = getFrameWaitTime();
+			}
+		}
+		
+		// Skipped frames don't get swapped, thus go on decoding. This also catches
+		// a swap that happened while this step was still marked as scheduled
+		m_decodeTaskState.lock();
+		
+		if (m_runThread &&
+			!m_isStarving &&
+			m_running.value() == 1 &&
+			m_backImageReady.value() == 0)
+		{
+			m_decodeTaskState.unlock(1);
+			DecodePool::instance().push(&m_decodeTask, delay);
+		}
+		else
+		{
+			m_decodeTaskState.unlock(0);
+		}
+	}
+	
+	void Movie_video::scheduleDecodeStep(void) const
+	{
+		m_decodeTaskState.lock();
+		
+		if (m_decodeTaskState.value() == 0)
+		{
+			m_decodeTaskState.unlock(1);
+			DecodePool::instance().push(&m_decodeTask);
+		}
+		else
+		{
+			m_decodeTaskState.unlock();
+		}
+	}
+	
+	Movie_video::DecodeTask::DecodeTask(Movie_video& video) :
+	m_video(video)
+	{
+	}
+	
+	void Movie_video::DecodeTask::execute(void)
+	{
+		m_video.decodeStep();
+	}
+	
+	void Movie_video::waitForFrameTime(void)
+	{
+		// Without any texture swap to wait for, the decoding thread is paced here.
+		// Sleep until the frame deadline, pause() and stop() wake us up earlier.
+		// Never called from the shared pool, whose steps are delayed instead
+		sf::Time waitTime = getFrameWaitTime();
+		
+		if (waitTime > sf::Time::Zero)
+			m_running.waitAndLock(0, waitTime, Condition::AutoUnlock);
+	}
+	
+	sf::Time Movie_video::getFrameWaitTime(void) const
+	{
+		// The playback clock goes faster than the real time when the speed is above 1
+		sf::Time waitTime;
+		getLateState(waitTime);
+		
+		return waitTime / m_parent.getPlaybackSpeed();
+	}
+	
 	bool Movie_video::getLateState(sf::Time& waitTime) const
 	{
 		bool flag = false;
@@ -403,7 +1062,7 @@ namespace sfe {
 		// and the progress of the video
 		
 		// Here is the real time elapsed since we started to play the video
-		sf::Time realTime = m_parent.getPlayingOffset();
+		sf::Time realTime = m_parent.getPlaybackClock();
 		
 		// Here is the time we're at in the video
 		// Note: m_wantedFrameTime is kept as float (seconds) for accuracy
@@ -426,13 +1085,13 @@ namespace sfe {
 			{
 				flag = true;
 				
-				if (Movie::usesDebugMessages())
-					std::cerr << "Movie_video::Run() - warning: skipping frame because we are late by " << sf::Time(realTime - movieTime).asMilliseconds() << "ms (movie playing offset is " << realTime.asMilliseconds() << "ms)" << std::endl;
+				LOG_DEBUG("Movie_video::Run() - warning: skipping frame because we are late by %dms (movie playing offset is %dms)",
+						  sf::Time(realTime - movieTime).asMilliseconds(), realTime.asMilliseconds());
 			}
 			else if (movieTime < realTime - m_wantedFrameTime && m_decodingTime > sf::Time::Zero)
 			{
-				if (Movie::usesDebugMessages())
-					std::cerr << "Movie_video::Run() - warning: movie playback is late by " << sf::Time(realTime - movieTime).asMilliseconds() << "ms (movie playing offset is " << realTime.asMilliseconds() << "ms) but we're not skipping any frame since we're not 'too' late" << std::endl;
+				LOG_DEBUG("Movie_video::Run() - warning: movie playback is late by %dms (movie playing offset is %dms) but we're not skipping any frame since we're not 'too' late",
+						  sf::Time(realTime - movieTime).asMilliseconds(), realTime.asMilliseconds());
 			}
 		}
 		
@@ -458,7 +1117,7 @@ namespace sfe {
 		
 		if (res < 0)
 		{
-			std::cerr << "Movie_video::SeekToTime() - av_seek_frame() failed" << std::endl;
+			LOG_ERROR("Movie_video::SeekToTime() - av_seek_frame() failed");
 		}
 		else
 		{
@@ -482,15 +1141,166 @@ namespace sfe {
 		
 		// Load first image
 		loadNextImage(false);
-		m_tex.update((sf::Uint8*)m_backRGBAFrame->data[0]);
 		
-		m_backImageReady = 1;
+		if (m_renderFrames)
+		{
+			m_tex.update((sf::Uint8*)m_backRGBAFrame->data[0]);
+			m_backImageReady = 1;
+		}
+		
 		return true;
 	}
 	
 	
+	bool Movie_video::preroll(sf::Time position, sf::Time prefill)
+	{
+		// Decode from the keyframe we seeked to, without converting the frames
+		// preceding the wanted position
+		bool didReachPosition = false;
+		
+		while (!didReachPosition && (hasPendingDecodableData() || readFrame()))
+		{
+			int didDecodeFrame = 0;
+			int res;
+			{
+				TRACE_SCOPE("avcodec_decode_video2");
+				res = avcodec_decode_video2(m_codecCtx, m_rawFrame, &didDecodeFrame, frontFrame());
+			}
+			popFrame();
+			
+			if (res < 0 || !didDecodeFrame)
+				continue;
+			
+			sf::Time timestamp = getFrameTimestamp();
+			
+			if (timestamp + m_wantedFrameTime / 2.f < position)
+				continue;
+			
+			sendFrameToSink();
+			didReachPosition = true;
+			m_displayedFrameCount = timestamp.asMicroseconds() / m_wantedFrameTime.asMicroseconds() + 1;
+			m_lastFrameTime = timestamp;
+			
+			if (m_renderFrames)
+			{
+				sws_scale(m_swsCtx,
+						  m_rawFrame->data, m_rawFrame->linesize,
+						  0, m_codecCtx->height,
+						  m_backRGBAFrame->data, m_backRGBAFrame->linesize);
+				m_tex.update((sf::Uint8*)m_backRGBAFrame->data[0]);
+				m_backImageReady = 1;
+			}
+		}
+		
+		if (!didReachPosition)
+		{
+			LOG_ERROR("Movie_video::preroll() - no video frame at %.3fs", position.asSeconds());
+			return false;
+		}
+		
+		// Demux ahead so that the decoding thread doesn't wait for the file at startup
+		AVRational tb = m_parent.getAVFormatContext()->streams[m_streamID]->time_base;
+		int64_t wantedDuration = av_rescale_q(prefill.asMicroseconds(), AV_TIME_BASE_Q, tb);
+		bool canRead = true;
+		
+		while (canRead)
+		{
+			m_statsMutex.lock();
+			canRead = m_pendingPacketDuration < wantedDuration;
+			m_statsMutex.unlock();
+			
+			canRead = canRead && m_parent.readFrameAndQueue();
+		}
+		
+		return true;
+	}
+	
+	bool Movie_video::startReverse(const std::string& filename, sf::Time position)
+	{
+		// Leave a core to the presentation
+		unsigned cores = DecodePool::detectCoreCount();
+		unsigned workerCount = std::min(std::max(cores, 2u) - 1, 4u);
+		
+		if (!m_reverseDecoder.start(filename, m_streamID, m_codecCtx->lowres, position, workerCount))
+			return false;
+		
+		// Don't show the image preloaded for the forward playback
+		m_backImageReady = 0;
+		m_displayedFrameCount = 0;
+		m_isReversing = true;
+		return true;
+	}
+	
+	bool Movie_video::loadReverseImage(bool isLate)
+	{
+		VideoFrame frame;
+		m_timer.restart();
+		
+		if (!m_reverseDecoder.next(frame))
+		{
+			// Unless stopping, the beginning of the movie has been reached
+			if (m_runThread)
+			{
+				LOG_DEBUG("Movie_video::loadReverseImage() - beginning of video stream reached.");
+				m_isStarving = true;
+			}
+			
+			return false;
+		}
+		
+		{
+			sf::Lock l(m_frameSinkMutex);
+			
+			if (m_frameSink)
+			{
+				TRACE_SCOPE("FrameSink::onFrame");
+				m_frameSink->onFrame(frame);
+			}
+		}
+		
+		m_displayedFrameCount++;
+		bool flag = false;
+		
+		if (!m_renderFrames)
+		{
+			flag = true;
+		}
+		else if (isLate || frame.m_size != sf::Vector2i(m_codecCtx->width, m_codecCtx->height))
+		{
+			sf::Lock l(m_statsMutex);
+			m_droppedFrames++;
+		}
+		else
+		{
+			sf::Clock conversionTimer;
+			m_imageSwapMutex.lock();
+			{
+				TRACE_SCOPE("sws_scale");
+				sws_scale(m_swsCtx,
+						  frame.m_data, frame.m_lineSize,
+						  0, m_codecCtx->height,
+						  m_backRGBAFrame->data, m_backRGBAFrame->linesize);
+			}
+			m_backFrameTime = frame.getTimestamp();
+			m_imageSwapMutex.unlock();
+			
+			m_statsMutex.lock();
+			m_conversionTimes.add(conversionTimer.getElapsedTime());
+			m_decodedFrames++;
+			m_statsMutex.unlock();
+			
+			flag = true;
+		}
+		
+		m_decodingTime = m_timer.getElapsedTime();
+		return flag;
+	}
+	
 	bool Movie_video::loadNextImage(bool isLate)
 	{
+		if (m_isReversing)
+			return loadReverseImage(isLate);
+		
 		bool flag = false;
 		m_timer.restart();
 		
@@ -500,8 +1310,7 @@ namespace sfe {
 			if (!readFrame())
 			{
 			    // Stop if there is no more data to read
-				if (Movie::usesDebugMessages())
-					std::cerr << "Movie_video::Update() - end of video stream reached." << std::endl;
+				LOG_DEBUG("Movie_video::Update() - end of video stream reached.");
 				
 				m_isStarving = true;
 			}
@@ -521,7 +1330,7 @@ namespace sfe {
 	bool Movie_video::readFrame(void)
 	{
 		while (!hasPendingDecodableData() &&
-			   m_parent.readFrameAndQueue());
+			   m_parent.readStreamPacket(m_streamID));
 		
 		return hasPendingDecodableData();
 	}
@@ -541,66 +1350,289 @@ namespace sfe {
 		// Stop here if there is no frame to decode
 		if (!hasPendingDecodableData())
 		{
-			if (Movie::usesDebugMessages())
-				std::cerr << "Movie_video::DecodeFrontFrame() - no frame currently available for decoding" << std::endl;
+			LOG_DEBUG("Movie_video::DecodeFrontFrame() - no frame currently available for decoding");
 			return flag;
 		}
 		
+		updateFrameSkipping(isLate);
+		
 		// Get the front frame and decode it
 		AVPacket *videoPacket = frontFrame();
+		bool isFlushing = isFlushPacket(videoPacket);
 		int res;
-		res = avcodec_decode_video2(m_codecCtx, m_rawFrame, &didDecodeFrame,
-									videoPacket); // 20% (40% of total function) on macosx; 18.3% (36% of total) on windows
+		sf::Clock decodingTimer;
+		{
+			TRACE_SCOPE("avcodec_decode_video2");
+			res = avcodec_decode_video2(m_codecCtx, m_rawFrame, &didDecodeFrame,
+										videoPacket); // 20% (40% of total function) on macosx; 18.3% (36% of total) on windows
+		}
+		sf::Time decodingTime = decodingTimer.getElapsedTime();
 		
-		if (!isLate)
+		m_statsMutex.lock();
+		m_decodingTimes.add(decodingTime);
+		m_statsMutex.unlock();
+		
+		if (isFlushing && (res < 0 || !didDecodeFrame))
+		{
+			// All the delayed frames have been output, the next packets come from
+			// the loop start
+			avcodec_flush_buffers(m_codecCtx);
+			m_isSkippingToLoopStart = m_parent.getLoopStart() > sf::Time::Zero;
+			popFrame();
+			return false;
+		}
+		
+		// After looping, the frames between the keyframe and the loop start are
+		// only decoded, as references
+		if (m_isSkippingToLoopStart && res >= 0 && didDecodeFrame)
+		{
+			if (getFrameTimestamp() + m_wantedFrameTime / 2.f < m_parent.getLoopStart())
+			{
+				popFrame();
+				return false;
+			}
+			
+			m_isSkippingToLoopStart = false;
+		}
+		
+		// Late frames are given to the sink too, only their display is skipped
+		if (res >= 0 && didDecodeFrame)
+			sendFrameToSink();
+		
+		if (!m_renderFrames)
+		{
+			flag = (res >= 0 && didDecodeFrame);
+			countFrame(flag);
+			
+			m_statsMutex.lock();
+			if (flag)
+				m_decodedFrames++;
+			m_statsMutex.unlock();
+		}
+		else if (!isLate)
 		{
 			if (res < 0)
 			{
-				std::cerr << "Movie_video::DecodeFrontFrame() - an error occured while decoding the video frame (code "
-				<< res << ")" << std::endl;
+				LOG_ERROR("Movie_video::DecodeFrontFrame() - an error occured while decoding the video frame (code %d)", res);
 			}
 			else
 			{
 				if (didDecodeFrame)
 				{
 					// Convert the frame to RGBA
+					sf::Clock conversionTimer;
 					m_imageSwapMutex.lock();
-					sws_scale(m_swsCtx,
-							  m_rawFrame->data, m_rawFrame->linesize,
-							  0, m_codecCtx->height,
-							  m_backRGBAFrame->data, m_backRGBAFrame->linesize);
-					// 6.3% on windows (12% of total), 9.5% on Mac OS X
-					
+					{
+						TRACE_SCOPE("sws_scale");
+						sws_scale(m_swsCtx,
+								  m_rawFrame->data, m_rawFrame->linesize,
+								  0, m_codecCtx->height,
+								  m_backRGBAFrame->data, m_backRGBAFrame->linesize);
+						// 6.3% on windows (12% of total), 9.5% on Mac OS X
+					}
 					m_imageSwapMutex.unlock();
 					
+					m_statsMutex.lock();
+					m_conversionTimes.add(conversionTimer.getElapsedTime());
+					m_decodedFrames++;
+					m_statsMutex.unlock();
+					
 					// Image loaded, reset condition state
-					m_displayedFrameCount++;
+					countFrame(true);
 					flag = true;
 					
 					
-					if (Movie::usesDebugMessages())
-						printWithTime("did decode a full image");
+					LOG_DEBUG("did decode a full image");
 				}
 				else
 				{
-					if (Movie::usesDebugMessages())
-						printWithTime("Movie_video::DecodeFrontFrame() - frame not decoded (or incomplete)");
+					LOG_DEBUG("Movie_video::DecodeFrontFrame() - frame not decoded (or incomplete)");
 				}
 			}
 		}
 		else {
-			m_displayedFrameCount++;
+			countFrame(res >= 0 && didDecodeFrame);
+			
+			m_statsMutex.lock();
+			m_droppedFrames++;
+			m_statsMutex.unlock();
 		}
 		
-		popFrame();
+		// The flush packet stays in front until the decoder has output all its frames
+		if (!isFlushing)
+			popFrame();
 		
 		return flag;
 	}
 	
+	void Movie_video::updateFrameSkipping(bool isLate)
+	{
+		static const enum AVDiscard skipFrames[] = {AVDISCARD_DEFAULT, AVDISCARD_NONREF, AVDISCARD_NONKEY};
+		float speed = m_parent.getPlaybackSpeed();
+		unsigned level = (speed > 4.f) ? 2 : ((speed > 2.f) ? 1 : 0);
+		
+		// Skip one more level of frames while the decoding is too slow for the
+		// speed, until it gets ahead of the playback clock again
+		if (speed > 1.f && level < 2)
+		{
+			sf::Time waitTime;
+			getLateState(waitTime);
+			
+			if (isLate && m_decodingTime * speed > m_wantedFrameTime)
+				level++;
+			else if (waitTime == sf::Time::Zero && m_frameSkipLevel > level)
+				level = m_frameSkipLevel;
+		}
+		
+		if (level != m_frameSkipLevel)
+		{
+			LOG_DEBUG("Movie_video::updateFrameSkipping() - skip level %u at speed %.2f", level, speed);
+			m_frameSkipLevel = level;
+			m_codecCtx->skip_frame = skipFrames[level];
+		}
+	}
+	
+	void Movie_video::countFrame(bool didDecodeFrame)
+	{
+		// The frames discarded by the decoder don't come out at all, thus the
+		// timestamps tell how many frames went by
+		if (m_frameSkipLevel == 0)
+		{
+			m_displayedFrameCount++;
+		}
+		else if (didDecodeFrame)
+		{
+			sf::Time timestamp = getFrameTimestamp();
+			sf::Int64 frameCount = 1;
+			
+			if (m_lastFrameTime >= sf::Time::Zero && timestamp > m_lastFrameTime)
+			{
+				sf::Time elapsed = timestamp - m_lastFrameTime + m_wantedFrameTime / 2.f;
+				frameCount = std::max(elapsed.asMicroseconds() / m_wantedFrameTime.asMicroseconds(), (sf::Int64)1);
+			}
+			
+			m_displayedFrameCount += frameCount;
+		}
+		
+		if (didDecodeFrame)
+			m_lastFrameTime = getFrameTimestamp();
+	}
+	
+	void Movie_video::sendFrameToSink(void)
+	{
+		sf::Lock l(m_frameSinkMutex);
+		
+		if (!m_frameSink)
+			return;
+		
+		VideoFrame frame;
+		fillVideoFrame(frame);
+		
+		TRACE_SCOPE("FrameSink::onFrame");
+		m_frameSink->onFrame(frame);
+	}
+	
+	void Movie_video::fillVideoFrame(VideoFrame& frame) const
+	{
+		frame.reset();
+		
+		for (int i = 0; i < VideoFrame::MaxPlanes; i++)
+		{
+			frame.m_data[i] = m_rawFrame->data[i];
+			frame.m_lineSize[i] = m_rawFrame->linesize[i];
+		}
+		
+		frame.m_pixelFormat = m_codecCtx->pix_fmt;
+		frame.m_size = sf::Vector2i(m_codecCtx->width, m_codecCtx->height);
+		frame.m_timestamp = getFrameTimestamp();
+		
+		// Share our buffer when the decoder used one, otherwise the frame only
+		// borrows the decoder's picture and gets copied if it is kept
+		if (m_usesOwnBuffers && m_rawFrame->type == FF_BUFFER_TYPE_USER && m_rawFrame->opaque)
+		{
+			frame.m_buffer = static_cast<FrameBuffer *>(m_rawFrame->opaque);
+			frame.m_buffer->retain();
+		}
+	}
+	
+	sf::Time Movie_video::getFrameTimestamp(void) const
+	{
+		AVStream *stream = m_parent.getAVFormatContext()->streams[m_streamID];
+		int64_t pts = m_rawFrame->best_effort_timestamp;
+		
+		if (pts == AV_NOPTS_VALUE)
+			return (sf::Int64)m_displayedFrameCount * m_wantedFrameTime;
+		
+		if (stream->start_time != AV_NOPTS_VALUE)
+			pts -= stream->start_time;
+		
+		return sf::microseconds(av_rescale_q(pts, stream->time_base, AV_TIME_BASE_Q));
+	}
+	
+	int Movie_video::getBuffer(AVCodecContext *ctx, AVFrame *pic)
+	{
+		int width = ctx->width;
+		int height = ctx->height;
+		int strideAlign[AV_NUM_DATA_POINTERS];
+		int lineAlign = 32;
+		
+		avcodec_align_dimensions2(ctx, &width, &height, strideAlign);
+		
+		for (int i = 0; i < 4; i++)
+			lineAlign = std::max(lineAlign, strideAlign[i]);
+		
+		FrameBuffer *buffer = FrameBuffer::create(ctx->pix_fmt, width, height, lineAlign);
+		
+		if (!buffer)
+		{
+			LOG_ERROR("Movie_video::getBuffer() - allocation error");
+			return -1;
+		}
+		
+		for (int i = 0; i < AV_NUM_DATA_POINTERS; i++)
+		{
+			pic->data[i] = (i < 4) ? buffer->data[i] : NULL;
+			pic->base[i] = pic->data[i];
+			pic->linesize[i] = (i < 4) ? buffer->lineSize[i] : 0;
+		}
+		
+		pic->extended_data = pic->data;
+		pic->opaque = buffer;
+		pic->type = FF_BUFFER_TYPE_USER;
+		pic->reordered_opaque = ctx->reordered_opaque;
+		pic->pkt_pts = ctx->pkt ? ctx->pkt->pts : AV_NOPTS_VALUE;
+		pic->width = ctx->width;
+		pic->height = ctx->height;
+		pic->format = ctx->pix_fmt;
+		pic->sample_aspect_ratio = ctx->sample_aspect_ratio;
+		
+		return 0;
+	}
+	
+	void Movie_video::releaseBuffer(AVCodecContext *, AVFrame *pic)
+	{
+		FrameBuffer *buffer = static_cast<FrameBuffer *>(pic->opaque);
+		
+		if (buffer)
+			buffer->release();
+		
+		for (int i = 0; i < AV_NUM_DATA_POINTERS; i++)
+		{
+			pic->data[i] = NULL;
+			pic->base[i] = NULL;
+		}
+		
+		pic->opaque = NULL;
+	}
+	
 	void Movie_video::pushFrame(AVPacket *pkt)
 	{
 		sf::Lock l(m_packetListMutex);
 		m_packetList.push(pkt);
+		
+		sf::Lock l2(m_statsMutex);
+		m_pendingPacketBytes += pkt->size;
+		m_pendingPacketDuration += pkt->duration;
 	}
 	
 	void Movie_video::popFrame(void)
@@ -611,6 +1643,12 @@ namespace sfe {
 		{
 			AVPacket *pkt = m_packetList.front();
 			m_packetList.pop();
+			
+			m_statsMutex.lock();
+			m_pendingPacketBytes -= pkt->size;
+			m_pendingPacketDuration -= pkt->duration;
+			m_statsMutex.unlock();
+			
 			av_free_packet(pkt);
 			av_free(pkt);
 		}
@@ -624,28 +1662,33 @@ namespace sfe {
 		return m_packetList.front();
 	}
 	
-	AVFrame *Movie_video::alloc_picture(enum PixelFormat pix_fmt, int width, int height, uint8_t *& picture_buf)
+	AVFrame *Movie_video::alloc_picture(enum PixelFormat pix_fmt, int width, int height, FrameBuffer *& picture_buf)
 	{
 		AVFrame *picture;
-		int size;
 	
 		picture = avcodec_alloc_frame();
 		if (!picture)
 		    return NULL;
-		size        = avpicture_get_size(pix_fmt, width, height);
-		picture_buf = (uint8_t *)av_malloc(size);
+		
+		// Packed lines, as m_tex.update() expects for the RGBA frames
+		picture_buf = FrameBuffer::create(pix_fmt, width, height, 1);
 		if (!picture_buf) {
 		    av_free(picture);
 		    return NULL;
 		}
-		avpicture_fill((AVPicture *)picture, picture_buf,
-		               pix_fmt, width, height);
+		
+		for (int i = 0; i < 4; i++)
+		{
+			picture->data[i] = picture_buf->data[i];
+			picture->linesize[i] = picture_buf->lineSize[i];
+		}
 		return picture;
 	}
 	
-	void Movie_video::free_picture(AVFrame *&picture, uint8_t *&picture_buffer)
+	void Movie_video::free_picture(AVFrame *&picture, FrameBuffer *&picture_buffer)
 	{
-		av_free(picture_buffer);
+		if (picture_buffer)
+			picture_buffer->release();
 		avcodec_free_frame(&picture);
 		picture_buffer = NULL;
 		picture = NULL;
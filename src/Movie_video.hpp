@@ -33,23 +33,29 @@ extern "C"
 
 #include <SFML/System.hpp>
 #include <SFML/Graphics.hpp>
+#include <sfeMovie/Movie.hpp>
 #include <queue>
 #include "Condition.hpp"
+#include "DecodePool.hpp"
+#include "StepCache.hpp"
+#include "ReverseDecoder.hpp"
 
 
 namespace sfe {
 	class Movie;
+	class FrameBuffer;
 	class Movie_video {
 	public:
 		Movie_video(Movie& parent);
 		~Movie_video(void);
 		
 		// -------------------------- Video methods ----------------------------
-		bool initialize(void);
+		bool initialize(int streamID);
 		void play(void);
 		void pause(void);
 		void stop(void);
 		void close(void);
+		void releaseBuffers(void);
 		
 		void draw(sf::RenderTarget& Target, sf::RenderStates& state) const;
 		
@@ -58,10 +64,30 @@ namespace sfe {
 		sf::Time getWantedFrameTime(void) const;
 		const sf::Texture& getCurrentFrame(void) const;
 		void ensureTextureUpdate(void) const;
+		void fillStatistics(Movie::Statistics& stats) const;
+		sf::Uint64 getQueuedBytes(void) const;
+		sf::Time getDisplayedPosition(void) const;
+		sf::Time getNextFrameTime(void) const;
+		void setFrameSink(FrameSink *sink, bool renderFrames);
+		bool decodeNextFrame(VideoFrame& frame);
+		bool decodeRawFrame(void);
+		bool step(sf::Time position, bool backward);
+		bool seek(sf::Time position);
+		bool fillStepCache(bool shouldSeek, sf::Time seekPosition, sf::Time until, sf::Time position);
+		void showStepFrame(sf::Time timestamp, FrameBuffer *buffer);
+		void setStepCacheCapacity(std::size_t bytes);
+		std::size_t getStepCacheCapacity(void) const;
+		bool startReverse(const std::string& filename, sf::Time position);
+		bool scrub(unsigned previewLevel);
+		bool extractFrame(sf::Time time, sf::Vector2u size, sf::Image& image);
 		
 		void decode(void); // Decoding thread
+		void decodeStep(void); // Decoding task when using the shared decode pool
+		void scheduleDecodeStep(void) const;
 		
 		bool getLateState(sf::Time& waitTime) const;
+		void waitForFrameTime(void);
+		sf::Time getFrameWaitTime(void) const;
 		bool isStarving(void);
 		void setPlayingOffset(sf::Time time);
 		//void SkipFrames(unsigned count);
@@ -72,33 +98,57 @@ namespace sfe {
 		sf::Texture& backTexture(void);
 		
 		bool preLoad(void);
+		bool preroll(sf::Time position, sf::Time prefill);
 		bool loadNextImage(bool isLate);
+		bool loadReverseImage(bool isLate);
 		bool readFrame(void);
 		bool hasPendingDecodableData(void);
 		bool decodeFrontFrame(bool isLate);
+		void updateFrameSkipping(bool isLate);
+		void countFrame(bool didDecodeFrame);
 		void pushFrame(AVPacket *pkt);
 		void popFrame(void);
 		AVPacket *frontFrame(void);
 		void watchThread(void);
-		AVFrame *alloc_picture(enum PixelFormat pix_fmt, int width, int height, uint8_t *& picture_buf);
-		void free_picture(AVFrame *&picture, uint8_t *&picture_buffer);
+		void sendFrameToSink(void);
+		void fillVideoFrame(VideoFrame& frame) const;
+		sf::Time getFrameTimestamp(void) const;
+		AVFrame *alloc_picture(enum PixelFormat pix_fmt, int width, int height, FrameBuffer *& picture_buf);
+		void free_picture(AVFrame *&picture, FrameBuffer *&picture_buffer);
+		
+		static int getBuffer(AVCodecContext *ctx, AVFrame *pic);
+		static void releaseBuffer(AVCodecContext *ctx, AVFrame *pic);
 		
 	private:
+		class DecodeTask : public DecodePool::Task {
+		public:
+			DecodeTask(Movie_video& video);
+			void execute(void);
+		private:
+			Movie_video& m_video;
+		};
+		
 		// ------------------------- Video attributes --------------------------
 		Movie& m_parent;			// Link to the parent movie
 		
 		// Image and decoding stuff
 		AVCodecContext *m_codecCtx; // Decoder information
 		AVCodec *m_codec;			// Video decoder
-		AVFrame *m_rawFrame;		// Original YUV422 frame
+		AVFrame *m_rawFrame;		// Last decoded frame, its planes belong to the decoder or to a FrameBuffer
 		mutable AVFrame *m_frontRGBAFrame;	// Front converted RGBA frame
 		mutable AVFrame *m_backRGBAFrame;	// Back converted RGBA frame
-		uint8_t *m_rawPictureBuffer;		// Buffers in previous AVFrames
-		uint8_t *m_frontRGBAPictureBuffer;
-		uint8_t *m_backRGBAPictureBuffer;
+		FrameBuffer *m_frontRGBAPictureBuffer;	// Buffers in previous AVFrames, taken from the FrameBufferPool
+		FrameBuffer *m_backRGBAPictureBuffer;
 		int m_streamID;				// The video stream identifier in the video file
-		sf::Uint8 *m_pictureBuffer; // Buffer used to convert image from pixel matrix to simple array
 		struct SwsContext *m_swsCtx;// Used for converting image from YUV422 to RGBA
+		sf::Vector2i m_bufferSize;	// Size of the frame buffers, kept across movies of the same format
+		enum PixelFormat m_bufferPixelFormat;
+		bool m_usesOwnBuffers;		// Whether the decoder decodes into FrameBuffer objects (codecs with CODEC_CAP_DR1)
+		
+		// Decoded frames output
+		FrameSink *m_frameSink;		// Receives every decoded frame, may be NULL
+		sf::Mutex m_frameSinkMutex;	// Held while the sink is being called
+		bool m_renderFrames;		// Whether the decoded frames are converted to RGBA and uploaded to m_tex
 		
 		// Packets' queueing stuff
 		std::queue <AVPacket *> m_packetList;// Awaiting video packets (that will be decoded later)
@@ -108,6 +158,9 @@ namespace sfe {
 		//sf::Thread m_updateThread;	// Does swaping and time sync
 		sf::Thread m_decodeThread;	// Does video decoding
 		Condition m_running;
+		mutable DecodeTask m_decodeTask;	// Decodes one image on the shared pool
+		mutable Condition m_decodeTaskState;// 1 while m_decodeTask is queued or running
+		bool m_usesDecodePool;		// Whether the current playback uses the shared pool instead of m_decodeThread
 		
 		// Image swaping
 		mutable sf::Mutex m_imageSwapMutex;// Prevent the textures from being swaped while being updated
@@ -125,6 +178,41 @@ namespace sfe {
 		sf::Time m_decodingTime;	// How long does it take to decode one frame? (used to know more precisely when we should decode and swap)
 		sf::Clock m_timer;			// Used to compute the decoding time
 		bool m_runThread;			// Should the updating and decoding still run?
+		bool m_isSkippingToLoopStart;// Whether the frames preceding the loop start are being dropped
+		unsigned m_frameSkipLevel;	// Frames discarded by the decoder, see updateFrameSkipping()
+		sf::Time m_lastFrameTime;	// Timestamp of the last decoded frame, negative if unknown
+		
+		// Frame stepping
+		StepCache m_stepCache;		// Frames decoded around the stepping position
+		sf::Time m_stepDecoderTime;	// Timestamp of the last frame decoded for stepping
+		bool m_isStepDecoderValid;	// Whether the decoder can go on from m_stepDecoderTime without seeking
+		
+		// Reverse playback
+		ReverseDecoder m_reverseDecoder;// Gives the frames in reverse order, instead of m_codecCtx
+		bool m_isReversing;			// Whether the current playback is backward
+		sf::Time m_backFrameTime;	// Timestamp of the image in m_backRGBAFrame, when reversing
+		
+		// Scrubbing
+		bool m_isScrubbing;			// Whether m_scrubTex is displayed instead of m_tex
+		int64_t m_scrubPacketTime;	// Timestamp of the displayed keyframe's packet, AV_NOPTS_VALUE if none
+		unsigned m_scrubLevel;		// Amount of halvings of m_size for m_scrubTex
+		AVFrame *m_scrubRGBAFrame;	// Keyframe converted at the reduced size
+		FrameBuffer *m_scrubPictureBuffer;
+		struct SwsContext *m_scrubSwsCtx;
+		mutable sf::Texture m_scrubTex;
+		sf::Sprite m_scrubSprite;	// Stretches m_scrubTex to m_size
+		
+		// Statistics, protected by m_statsMutex
+		mutable sf::Mutex m_statsMutex;
+		sf::Uint64 m_decodedFrames;
+		mutable sf::Uint64 m_displayedFrames;
+		sf::Uint64 m_droppedFrames;
+		mutable sf::Uint64 m_lateFrames;
+		TimeHistogram m_decodingTimes;
+		TimeHistogram m_conversionTimes;
+		sf::Uint64 m_pendingPacketBytes;	// Size of the packets in m_packetList
+		int64_t m_pendingPacketDuration;	// Duration of the packets in m_packetList, in stream time base
+		mutable sf::Time m_frontFrameTime;	// Presentation time of the image in m_tex
 	};
 } // namespace sfe
 
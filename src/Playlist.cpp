@@ -0,0 +1,358 @@
+/*
+ *  Playlist.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/Playlist.hpp>
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include "Trace.hpp"
+#include "Log.hpp"
+
+namespace sfe {
+
+	Playlist::Playlist(void) :
+	m_files(),
+	m_current(new Movie),
+	m_next(new Movie),
+	m_currentIndex(0),
+	m_nextIndex(0),
+	m_failedCount(0),
+	m_prepareThread(&Playlist::prepare, this),
+	m_preparationState(Idle),
+	m_preparationMutex(),
+	m_isPlaying(false),
+	m_isCrossfading(false),
+	m_loop(false),
+	m_crossfade(sf::Time::Zero),
+	m_volume(100)
+	{
+	}
+
+	Playlist::~Playlist(void)
+	{
+		m_prepareThread.wait();
+		delete m_current;
+		delete m_next;
+	}
+
+	void Playlist::add(const std::string& filename)
+	{
+		m_files.push_back(filename);
+	}
+
+	void Playlist::clear(void)
+	{
+		stop();
+		m_files.clear();
+	}
+
+	unsigned Playlist::getCount(void) const
+	{
+		return m_files.size();
+	}
+
+	void Playlist::setLoop(bool flag)
+	{
+		m_loop = flag;
+	}
+
+	bool Playlist::getLoop(void) const
+	{
+		return m_loop;
+	}
+
+	void Playlist::setCrossfade(sf::Time duration)
+	{
+		m_crossfade = duration;
+	}
+
+	sf::Time Playlist::getCrossfade(void) const
+	{
+		return m_crossfade;
+	}
+
+	void Playlist::setVolume(float volume)
+	{
+		m_volume = volume;
+
+		if (!m_isCrossfading)
+			m_current->setVolume(volume);
+	}
+
+	float Playlist::getVolume(void) const
+	{
+		return m_volume;
+	}
+
+	bool Playlist::play(void)
+	{
+		if (m_isPlaying)
+			return true;
+
+		// Resume a paused playback
+		if (m_current->getStatus() == Movie::Paused)
+		{
+			m_current->play();
+
+			if (m_isCrossfading)
+				m_next->play();
+
+			m_isPlaying = true;
+			return true;
+		}
+
+		stop();
+
+		for (unsigned i = 0; i < m_files.size(); i++)
+		{
+			if (m_current->openFromFile(m_files[i]))
+			{
+				unsigned following;
+				m_currentIndex = i;
+				m_current->setVolume(m_volume);
+				m_current->play();
+				m_isPlaying = true;
+
+				if (getFollowingIndex(i, following))
+					startPreparing(following);
+
+				return true;
+			}
+
+			LOG_ERROR("Playlist::play() - unable to open %s, skipping it", m_files[i].c_str());
+		}
+
+		return false;
+	}
+
+	void Playlist::pause(void)
+	{
+		if (m_isPlaying)
+		{
+			m_current->pause();
+
+			if (m_isCrossfading)
+				m_next->pause();
+
+			m_isPlaying = false;
+		}
+	}
+
+	void Playlist::stop(void)
+	{
+		m_prepareThread.wait();
+		m_current->stop();
+		m_next->stop();
+
+		m_preparationState = Idle;
+		m_currentIndex = 0;
+		m_failedCount = 0;
+		m_isPlaying = false;
+		m_isCrossfading = false;
+	}
+
+	bool Playlist::isPlaying(void) const
+	{
+		return m_isPlaying;
+	}
+
+	void Playlist::update(void)
+	{
+		if (!m_isPlaying)
+			return;
+
+		PreparationState state = getPreparationState();
+		bool hasEnded = m_current->getStatus() == Movie::Stopped;
+		sf::Time duration = m_current->getDuration();
+		sf::Time offset = m_current->getPlayingOffset();
+
+		if (m_isCrossfading)
+		{
+			float progress = 1.f;
+
+			if (m_crossfade > sf::Time::Zero)
+				progress = std::min(1.f, (offset - (duration - m_crossfade)).asSeconds() / m_crossfade.asSeconds());
+
+			m_current->setVolume(m_volume * (1.f - progress));
+			m_next->setVolume(m_volume * progress);
+
+			if (hasEnded || progress >= 1.f)
+				switchToNext();
+		}
+		else if (state == Ready)
+		{
+			// Start the next movie so that its first frame directly follows
+			// the last frame of the current one
+			sf::Time frameTime = sf::Time::Zero;
+
+			if (m_current->getFramerate() > 0)
+				frameTime = sf::seconds(1.f / m_current->getFramerate());
+
+			sf::Time transition = std::max(m_crossfade, frameTime);
+			bool isInTransition = duration > sf::Time::Zero && offset >= duration - transition;
+
+			if (hasEnded || isInTransition)
+			{
+				if (m_crossfade > sf::Time::Zero && !hasEnded)
+				{
+					m_next->setVolume(0);
+					m_next->play();
+					m_isCrossfading = true;
+				}
+				else
+				{
+					m_next->setVolume(m_volume);
+					m_next->play();
+					switchToNext();
+				}
+			}
+		}
+		else if (state == Failed)
+		{
+			unsigned following;
+
+			// Try the movie after the one that could not be opened
+			if (m_failedCount < m_files.size() && getFollowingIndex(m_nextIndex, following))
+			{
+				startPreparing(following);
+			}
+			else if (hasEnded)
+			{
+				m_isPlaying = false;
+			}
+		}
+		else if (state == Idle && hasEnded)
+		{
+			// End of the playlist
+			m_isPlaying = false;
+		}
+	}
+
+	unsigned Playlist::getCurrentIndex(void) const
+	{
+		return m_currentIndex;
+	}
+
+	const Movie& Playlist::getCurrentMovie(void) const
+	{
+		return *m_current;
+	}
+
+	void Playlist::draw(sf::RenderTarget& target, sf::RenderStates states) const
+	{
+		states.transform *= getTransform();
+
+		sf::Sprite sprite;
+		sprite.setTexture(m_current->getCurrentFrame(), true);
+		target.draw(sprite, states);
+
+		if (m_isCrossfading)
+		{
+			sf::Time offset = m_current->getPlayingOffset();
+			sf::Time fadeStart = m_current->getDuration() - m_crossfade;
+			float progress = std::max(0.f, std::min(1.f, (offset - fadeStart).asSeconds() / m_crossfade.asSeconds()));
+
+			sf::Sprite nextSprite;
+			nextSprite.setTexture(m_next->getCurrentFrame(), true);
+			nextSprite.setColor(sf::Color(255, 255, 255, (sf::Uint8)(progress * 255)));
+			target.draw(nextSprite, states);
+		}
+	}
+
+	void Playlist::prepare(void)
+	{
+		Trace::setThreadName("sfeMovie playlist");
+		TRACE_SCOPE("Playlist::prepare");
+
+		// The previous movie may still be open
+		m_next->stop();
+
+		bool success = m_next->openFromFile(m_files[m_nextIndex]) &&
+					   m_next->preroll(sf::Time::Zero);
+
+		if (!success)
+			LOG_ERROR("Playlist::prepare() - unable to open %s", m_files[m_nextIndex].c_str());
+
+		sf::Lock l(m_preparationMutex);
+		m_preparationState = success ? Ready : Failed;
+	}
+
+	void Playlist::startPreparing(unsigned index)
+	{
+		m_prepareThread.wait();
+
+		if (getPreparationState() == Failed)
+			m_failedCount++;
+		else
+			m_failedCount = 0;
+
+		m_nextIndex = index;
+		m_preparationState = Preparing;
+		m_prepareThread.launch();
+	}
+
+	Playlist::PreparationState Playlist::getPreparationState(void) const
+	{
+		sf::Lock l(m_preparationMutex);
+		return m_preparationState;
+	}
+
+	bool Playlist::getFollowingIndex(unsigned index, unsigned& following) const
+	{
+		if (index + 1 < m_files.size())
+		{
+			following = index + 1;
+			return true;
+		}
+
+		if (m_loop && !m_files.empty())
+		{
+			following = 0;
+			return true;
+		}
+
+		return false;
+	}
+
+	void Playlist::switchToNext(void)
+	{
+		unsigned following;
+
+		std::swap(m_current, m_next);
+		m_currentIndex = m_nextIndex;
+		m_current->setVolume(m_volume);
+		m_isCrossfading = false;
+
+		{
+			sf::Lock l(m_preparationMutex);
+			m_preparationState = Idle;
+		}
+
+		// The previous movie is stopped by the preparation thread when possible,
+		// to keep the render thread from waiting for its decoding threads
+		if (getFollowingIndex(m_currentIndex, following))
+			startPreparing(following);
+		else
+			m_next->stop();
+	}
+
+} // namespace sfe
@@ -0,0 +1,502 @@
+/*
+ *  ReverseDecoder.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "ReverseDecoder.hpp"
+#include "Movie_video.hpp"
+#include "FrameBuffer.hpp"
+#include "Atomic.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
+#include <algorithm>
+
+// Groups of pictures up to REVERSE_MAX_CHUNK seconds long are decoded as a whole,
+// longer ones are cut into chunks of this duration. A chunk is decoded from the
+// keyframe preceding its end by at least REVERSE_MIN_CHUNK seconds
+#define REVERSE_MIN_CHUNK 0.5f
+#define REVERSE_MAX_CHUNK 2.f
+
+// Memory used by the chunks decoded ahead, about 80 frames of a 1080p movie
+#define REVERSE_BUDGET (256 * 1024 * 1024)
+
+namespace sfe {
+
+	ReverseDecoder::ReverseDecoder(void) :
+	m_workers(),
+	m_chunks(),
+	m_currentFrames(),
+	m_nextEnd(sf::Time::Zero),
+	m_isNextEndKnown(false),
+	m_decodedSize(0),
+	m_budget(REVERSE_BUDGET),
+	m_isRunning(0),
+	m_mutex(),
+	m_frameReady(0)
+	{
+	}
+
+	ReverseDecoder::~ReverseDecoder(void)
+	{
+		stop();
+	}
+
+	bool ReverseDecoder::start(const std::string& filename, int streamID, int lowres, sf::Time position, unsigned workerCount)
+	{
+		stop();
+
+		for (unsigned i = 0; i < workerCount; i++)
+		{
+			Worker *worker = new Worker(*this);
+
+			if (!worker->open(filename, streamID, lowres))
+			{
+				delete worker;
+				break;
+			}
+
+			m_workers.push_back(worker);
+		}
+
+		if (m_workers.empty())
+		{
+			LOG_ERROR("ReverseDecoder::start() - unable to decode %s", filename.c_str());
+			return false;
+		}
+
+		// The frame presented at @position is the first one given
+		m_currentFrames.clear();
+		m_nextEnd = position + sf::microseconds(1);
+		m_isNextEndKnown = true;
+		m_decodedSize = 0;
+		m_frameReady.restore();
+		m_frameReady = 0;
+		atomicStore(&m_isRunning, 1);
+
+		for (unsigned i = 0; i < m_workers.size(); i++)
+			m_workers[i]->m_thread.launch();
+
+		return true;
+	}
+
+	void ReverseDecoder::stop(void)
+	{
+		if (m_workers.empty())
+			return;
+
+		// The conditions are restored by start(), so that a consumer still
+		// calling next() never waits from now on
+		atomicStore(&m_isRunning, 0);
+		m_frameReady.invalidate();
+
+		for (unsigned i = 0; i < m_workers.size(); i++)
+			m_workers[i]->m_wakeUp.invalidate();
+
+		for (unsigned i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i]->m_thread.wait();
+			delete m_workers[i];
+		}
+
+		m_workers.clear();
+
+		sf::Lock l(m_mutex);
+
+		while (m_chunks.size())
+		{
+			delete m_chunks.front();
+			m_chunks.pop_front();
+		}
+
+		m_decodedSize = 0;
+	}
+
+	bool ReverseDecoder::isRunning(void) const
+	{
+		return atomicLoad(&m_isRunning) != 0;
+	}
+
+	bool ReverseDecoder::next(VideoFrame& frame)
+	{
+		while (m_currentFrames.empty())
+		{
+			m_mutex.lock();
+
+			if (!atomicLoad(&m_isRunning))
+			{
+				m_mutex.unlock();
+				return false;
+			}
+
+			if (m_chunks.empty() || !m_chunks.front()->isDecoded)
+			{
+				bool isFinished = m_chunks.empty() && m_isNextEndKnown && m_nextEnd <= sf::Time::Zero;
+
+				if (!isFinished)
+					m_frameReady = 0;
+
+				m_mutex.unlock();
+
+				if (isFinished)
+					return false;
+
+				TRACE_SCOPE("wait reverse chunk");
+				m_frameReady.waitAndLock(1, Condition::AutoUnlock);
+				continue;
+			}
+
+			Chunk *chunk = m_chunks.front();
+			m_chunks.pop_front();
+			m_decodedSize -= chunk->size;
+			m_currentFrames.swap(chunk->frames);
+			m_mutex.unlock();
+
+			delete chunk;
+
+			// There may be room for decoding more chunks now
+			notifyAll();
+		}
+
+		frame = m_currentFrames.back();
+		m_currentFrames.pop_back();
+		return true;
+	}
+
+	ReverseDecoder::Chunk *ReverseDecoder::takeChunk(Worker& worker)
+	{
+		for (;;)
+		{
+			m_mutex.lock();
+
+			if (!atomicLoad(&m_isRunning) || (m_isNextEndKnown && m_nextEnd <= sf::Time::Zero))
+			{
+				m_mutex.unlock();
+				return NULL;
+			}
+
+			// One chunk is always being decoded ahead of the consumed one, the
+			// other workers help as long as the budget allows it
+			bool canDecode = m_isNextEndKnown &&
+				(m_chunks.empty() || (m_decodedSize < m_budget && m_chunks.size() <= m_workers.size()));
+
+			if (canDecode)
+			{
+				Chunk *chunk = new Chunk;
+				chunk->end = m_nextEnd;
+				chunk->begin = sf::Time::Zero;
+				chunk->isDecoded = false;
+				chunk->size = 0;
+
+				m_chunks.push_back(chunk);
+				m_isNextEndKnown = false;
+				m_mutex.unlock();
+				return chunk;
+			}
+
+			worker.m_wakeUp = 0;
+			m_mutex.unlock();
+
+			worker.m_wakeUp.waitAndLock(1, Condition::AutoUnlock);
+		}
+	}
+
+	void ReverseDecoder::setChunkBegin(Chunk& chunk, sf::Time begin)
+	{
+		m_mutex.lock();
+		chunk.begin = begin;
+		m_nextEnd = begin;
+		m_isNextEndKnown = true;
+		m_mutex.unlock();
+
+		notifyAll();
+	}
+
+	void ReverseDecoder::setChunkDecoded(Chunk& chunk)
+	{
+		m_mutex.lock();
+		chunk.isDecoded = true;
+		m_decodedSize += chunk.size;
+		m_mutex.unlock();
+
+		notifyAll();
+	}
+
+	void ReverseDecoder::notifyAll(void)
+	{
+		// Each waiter resets its own condition before waiting, with m_mutex
+		// held, thus none of them can miss a change
+		m_frameReady = 1;
+
+		for (unsigned i = 0; i < m_workers.size(); i++)
+			m_workers[i]->m_wakeUp = 1;
+	}
+
+	void ReverseDecoder::fillFrame(VideoFrame& frame, AVFrame *picture, AVCodecContext *codecCtx,
+								   sf::Time timestamp, bool usesOwnBuffers)
+	{
+		frame.reset();
+
+		for (int i = 0; i < VideoFrame::MaxPlanes; i++)
+		{
+			frame.m_data[i] = picture->data[i];
+			frame.m_lineSize[i] = picture->linesize[i];
+		}
+
+		frame.m_pixelFormat = codecCtx->pix_fmt;
+		frame.m_size = sf::Vector2i(codecCtx->width, codecCtx->height);
+		frame.m_timestamp = timestamp;
+
+		// Same as Movie_video::fillVideoFrame(), frames decoded in the decoder's
+		// own buffers are copied when kept
+		if (usesOwnBuffers && picture->type == FF_BUFFER_TYPE_USER && picture->opaque)
+		{
+			frame.m_buffer = static_cast<FrameBuffer *>(picture->opaque);
+			frame.m_buffer->retain();
+		}
+	}
+
+	std::size_t ReverseDecoder::getFrameSize(const VideoFrame& frame)
+	{
+		return frame.m_buffer ? frame.m_buffer->getSize() : 0;
+	}
+
+	ReverseDecoder::Worker::Worker(ReverseDecoder& decoder) :
+	m_wakeUp(0),
+	m_thread(&ReverseDecoder::Worker::run, this),
+	m_decoder(decoder),
+	m_formatCtx(NULL),
+	m_codecCtx(NULL),
+	m_frame(NULL),
+	m_streamID(-1),
+	m_usesOwnBuffers(false)
+	{
+	}
+
+	ReverseDecoder::Worker::~Worker(void)
+	{
+		close();
+	}
+
+	bool ReverseDecoder::Worker::open(const std::string& filename, int streamID, int lowres)
+	{
+		if (avformat_open_input(&m_formatCtx, filename.c_str(), NULL, NULL) != 0)
+		{
+			LOG_ERROR("ReverseDecoder::Worker::open() - unable to open %s", filename.c_str());
+			return false;
+		}
+
+		if (avformat_find_stream_info(m_formatCtx, NULL) < 0 ||
+			streamID >= (int)m_formatCtx->nb_streams)
+		{
+			LOG_ERROR("ReverseDecoder::Worker::open() - unable to find stream %d in %s", streamID, filename.c_str());
+			close();
+			return false;
+		}
+
+		// Demux the video stream only
+		for (unsigned i = 0; i < m_formatCtx->nb_streams; i++)
+		{
+			if ((int)i != streamID)
+				m_formatCtx->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		m_codecCtx = m_formatCtx->streams[streamID]->codec;
+		AVCodec *codec = avcodec_find_decoder(m_codecCtx->codec_id);
+
+		if (!codec)
+		{
+			LOG_ERROR("ReverseDecoder::Worker::open() - no decoder for the video stream of %s", filename.c_str());
+			m_codecCtx = NULL;
+			close();
+			return false;
+		}
+
+		// The chunks are already decoded in parallel
+		m_codecCtx->thread_count = 1;
+		m_codecCtx->lowres = std::min(lowres, (int)codec->max_lowres);
+		m_usesOwnBuffers = (codec->capabilities & CODEC_CAP_DR1) != 0;
+
+		if (m_usesOwnBuffers)
+		{
+			m_codecCtx->flags |= CODEC_FLAG_EMU_EDGE;
+			m_codecCtx->get_buffer = &Movie_video::getBuffer;
+			m_codecCtx->release_buffer = &Movie_video::releaseBuffer;
+		}
+
+		if (avcodec_open2(m_codecCtx, codec, NULL) < 0)
+		{
+			LOG_ERROR("ReverseDecoder::Worker::open() - unable to load the video decoder for %s", filename.c_str());
+			m_codecCtx = NULL;
+			close();
+			return false;
+		}
+
+		m_frame = avcodec_alloc_frame();
+
+		if (!m_frame)
+		{
+			LOG_ERROR("ReverseDecoder::Worker::open() - allocation error");
+			close();
+			return false;
+		}
+
+		m_streamID = streamID;
+		return true;
+	}
+
+	void ReverseDecoder::Worker::close(void)
+	{
+		if (m_frame)
+			avcodec_free_frame(&m_frame);
+
+		if (m_codecCtx)
+			avcodec_close(m_codecCtx), m_codecCtx = NULL;
+
+		if (m_formatCtx)
+			avformat_close_input(&m_formatCtx);
+
+		m_streamID = -1;
+	}
+
+	void ReverseDecoder::Worker::run(void)
+	{
+		Trace::setThreadName("sfeMovie reverse decoding");
+
+		while (Chunk *chunk = m_decoder.takeChunk(*this))
+			decodeChunk(*chunk);
+	}
+
+	void ReverseDecoder::Worker::decodeChunk(Chunk& chunk)
+	{
+		TRACE_SCOPE("ReverseDecoder::decodeChunk");
+		sf::Time target = chunk.end - sf::seconds(REVERSE_MIN_CHUNK);
+
+		if (target < sf::Time::Zero)
+			target = sf::Time::Zero;
+
+		AVStream *stream = m_formatCtx->streams[m_streamID];
+		int64_t timestamp = av_rescale_q(target.asMicroseconds(), AV_TIME_BASE_Q, stream->time_base);
+
+		if (stream->start_time != AV_NOPTS_VALUE)
+			timestamp += stream->start_time;
+
+		if (av_seek_frame(m_formatCtx, m_streamID, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+		{
+			LOG_WARNING("ReverseDecoder::Worker::decodeChunk() - unable to seek to %.3fs", target.asSeconds());
+		}
+
+		avcodec_flush_buffers(m_codecCtx);
+
+		sf::Time begin = target;
+		bool isBeginKnown = false;
+		bool isDone = false;
+		bool eof = false;
+		AVPacket packet;
+
+		while (!isDone && atomicLoad(&m_decoder.m_isRunning))
+		{
+			av_init_packet(&packet);
+
+			if (av_read_frame(m_formatCtx, &packet) < 0)
+			{
+				// Get the frames still delayed in the decoder
+				eof = true;
+				packet.data = NULL;
+				packet.size = 0;
+				packet.stream_index = m_streamID;
+			}
+
+			int didDecodeFrame = 0;
+
+			if (packet.stream_index == m_streamID)
+			{
+				TRACE_SCOPE("avcodec_decode_video2");
+
+				if (avcodec_decode_video2(m_codecCtx, m_frame, &didDecodeFrame, &packet) < 0)
+				{
+					LOG_DEBUG("ReverseDecoder::Worker::decodeChunk() - an error occured while decoding the video frame");
+					didDecodeFrame = 0;
+				}
+			}
+
+			if (!eof)
+				av_free_packet(&packet);
+
+			sf::Time time;
+
+			if (!didDecodeFrame || !getFrameTimestamp(time))
+			{
+				isDone = eof && !didDecodeFrame;
+				continue;
+			}
+
+			if (!isBeginKnown)
+			{
+				// The first decoded frame is the keyframe we seeked to, which lets
+				// the next worker go on with the preceding chunk right away
+				if (target == sf::Time::Zero)
+					begin = sf::Time::Zero;
+				else if (time <= target)
+					begin = std::max(time, chunk.end - sf::seconds(REVERSE_MAX_CHUNK));
+
+				m_decoder.setChunkBegin(chunk, begin);
+				isBeginKnown = true;
+			}
+
+			if (time >= chunk.end)
+			{
+				isDone = true;
+			}
+			else if (time >= begin)
+			{
+				VideoFrame frame;
+				fillFrame(frame, m_frame, m_codecCtx, time, m_usesOwnBuffers);
+
+				// Frames that are not in our buffers are copied here
+				chunk.frames.push_back(frame);
+				chunk.size += getFrameSize(chunk.frames.back());
+			}
+		}
+
+		// Go on with the preceding chunk even if nothing could be decoded
+		if (!isBeginKnown)
+			m_decoder.setChunkBegin(chunk, begin);
+
+		m_decoder.setChunkDecoded(chunk);
+	}
+
+	bool ReverseDecoder::Worker::getFrameTimestamp(sf::Time& timestamp) const
+	{
+		AVStream *stream = m_formatCtx->streams[m_streamID];
+		int64_t pts = m_frame->best_effort_timestamp;
+
+		// Frames that can't be placed in time are dropped
+		if (pts == AV_NOPTS_VALUE)
+			return false;
+
+		if (stream->start_time != AV_NOPTS_VALUE)
+			pts -= stream->start_time;
+
+		timestamp = sf::microseconds(av_rescale_q(pts, stream->time_base, AV_TIME_BASE_Q));
+		return true;
+	}
+
+} // namespace sfe
@@ -0,0 +1,145 @@
+/*
+ *  ReverseDecoder.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef REVERSE_DECODER_HPP
+#define REVERSE_DECODER_HPP
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+#include <SFML/System.hpp>
+#include <sfeMovie/VideoFrame.hpp>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "Condition.hpp"
+
+namespace sfe {
+
+/* Decodes a video stream backward, for reverse playback.
+ *
+ * The stream is cut into chunks going from the starting position down to the
+ * beginning. Each chunk starts on a keyframe when the group of pictures is
+ * short enough, thus it is decoded once from its keyframe to its end. Longer
+ * groups of pictures are cut into chunks of bounded duration, each of them
+ * being decoded from the preceding keyframe.
+ *
+ * Worker threads decode the chunks in parallel, each one with its own reader
+ * and decoder of the file. The start of a chunk, and thus the end of the
+ * following one, is known as soon as its keyframe is decoded, so the next
+ * worker doesn't wait for the whole chunk. The decoded frames are kept in
+ * their native pixel format and handed out in reverse order by next().
+ *
+ * The amount of chunks decoded ahead is bounded by a memory budget.
+ */
+class ReverseDecoder {
+public:
+	ReverseDecoder(void);
+	~ReverseDecoder(void);
+
+	/* Opens @workerCount readers of stream @streamID of @filename, decoding at
+	 * @lowres, and starts decoding backward from the frame presented at @position
+	 */
+	bool start(const std::string& filename, int streamID, int lowres, sf::Time position, unsigned workerCount);
+
+	/* Stops the workers and drops the decoded frames. Any call to next()
+	 * waiting for frames returns false
+	 */
+	void stop(void);
+	bool isRunning(void) const;
+
+	/* Gives the frame preceding the previously given one, waiting for it to be
+	 * decoded if needed. Returns false once the beginning of the stream has
+	 * been reached or if the decoder has been stopped
+	 */
+	bool next(VideoFrame& frame);
+
+private:
+	struct Chunk {
+		sf::Time end;		// Frames presented before this time belong to the chunk...
+		sf::Time begin;		// ...down to this one, known once the keyframe is decoded
+		bool isDecoded;
+		std::size_t size;	// Bytes used by the frames
+		std::vector<VideoFrame> frames; // In presentation order
+	};
+
+	class Worker {
+	public:
+		Worker(ReverseDecoder& decoder);
+		~Worker(void);
+
+		bool open(const std::string& filename, int streamID, int lowres);
+		void close(void);
+		void run(void);
+
+		Condition m_wakeUp;	// Set to 1 when the state of the chunks changed
+		sf::Thread m_thread;
+
+	private:
+		void decodeChunk(Chunk& chunk);
+		bool getFrameTimestamp(sf::Time& timestamp) const;
+
+		ReverseDecoder& m_decoder;
+		AVFormatContext *m_formatCtx;
+		AVCodecContext *m_codecCtx;
+		AVFrame *m_frame;
+		int m_streamID;
+		bool m_usesOwnBuffers;
+	};
+	friend class Worker;
+
+	// Gives the next chunk to decode to a worker, waiting while the decoded
+	// chunks don't fit in the budget. Returns NULL once there is none left
+	Chunk *takeChunk(Worker& worker);
+
+	// Called by the workers once the start of @chunk is known, or once it is decoded
+	void setChunkBegin(Chunk& chunk, sf::Time begin);
+	void setChunkDecoded(Chunk& chunk);
+
+	// Wakes up the consumer and all the workers
+	void notifyAll(void);
+
+	// Makes @frame share the picture decoded in @picture
+	static void fillFrame(VideoFrame& frame, AVFrame *picture, AVCodecContext *codecCtx,
+						  sf::Time timestamp, bool usesOwnBuffers);
+	static std::size_t getFrameSize(const VideoFrame& frame);
+
+	std::vector<Worker *> m_workers;
+	std::deque<Chunk *> m_chunks;	// Given to workers and not consumed yet, latest first
+	std::vector<VideoFrame> m_currentFrames;// Frames of the chunk being consumed
+	sf::Time m_nextEnd;			// End of the next chunk to create...
+	bool m_isNextEndKnown;		// ...valid once the start of the previous chunk is known
+	std::size_t m_decodedSize;	// Bytes used by the decoded chunks in m_chunks
+	std::size_t m_budget;
+	mutable volatile long m_isRunning;
+	sf::Mutex m_mutex;			// Protects the chunks
+	Condition m_frameReady;		// Set to 1 when the consumer may have frames to take
+};
+
+} // namespace sfe
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ *  SideDemuxer.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "SideDemuxer.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
+
+namespace sfe {
+
+	SideDemuxer::SideDemuxer(void) :
+	m_formatCtx(NULL),
+	m_streamID(-1),
+	m_lastDts(AV_NOPTS_VALUE)
+	{
+	}
+
+	SideDemuxer::~SideDemuxer(void)
+	{
+		close();
+	}
+
+	bool SideDemuxer::open(const std::string& filename, int streamID, int64_t lastDts)
+	{
+		close();
+
+		if (avformat_open_input(&m_formatCtx, filename.c_str(), NULL, NULL) != 0)
+		{
+			LOG_ERROR("SideDemuxer::open() - unable to open %s", filename.c_str());
+			return false;
+		}
+
+		if (avformat_find_stream_info(m_formatCtx, NULL) < 0 ||
+			streamID >= (int)m_formatCtx->nb_streams)
+		{
+			LOG_ERROR("SideDemuxer::open() - unable to find stream %d in %s", streamID, filename.c_str());
+			close();
+			return false;
+		}
+
+		// Don't spend any time on the other streams
+		for (unsigned i = 0; i < m_formatCtx->nb_streams; i++)
+		{
+			if ((int)i != streamID)
+				m_formatCtx->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		if (lastDts != AV_NOPTS_VALUE &&
+			av_seek_frame(m_formatCtx, streamID, lastDts, AVSEEK_FLAG_BACKWARD) < 0)
+		{
+			LOG_ERROR("SideDemuxer::open() - av_seek_frame() error");
+			close();
+			return false;
+		}
+
+		m_streamID = streamID;
+		m_lastDts = lastDts;
+		return true;
+	}
+
+	void SideDemuxer::close(void)
+	{
+		if (m_formatCtx)
+			avformat_close_input(&m_formatCtx);
+
+		m_streamID = -1;
+		m_lastDts = AV_NOPTS_VALUE;
+	}
+
+	bool SideDemuxer::isOpen(void) const
+	{
+		return m_formatCtx != NULL;
+	}
+
+	int SideDemuxer::getStreamID(void) const
+	{
+		return m_streamID;
+	}
+
+	AVPacket *SideDemuxer::read(void)
+	{
+		if (!m_formatCtx)
+			return NULL;
+
+		AVPacket *pkt = (AVPacket *)av_malloc(sizeof(*pkt));
+
+		for (;;)
+		{
+			av_init_packet(pkt);
+
+			int res;
+			{
+				TRACE_SCOPE("av_read_frame (side)");
+				res = av_read_frame(m_formatCtx, pkt);
+			}
+
+			if (res < 0)
+			{
+				av_free(pkt);
+				return NULL;
+			}
+
+			// The seek went back to the preceding keyframe, skip the packets
+			// that have already been queued by the main demuxer
+			bool isQueued = (pkt->stream_index != m_streamID ||
+							 (m_lastDts != AV_NOPTS_VALUE && pkt->dts != AV_NOPTS_VALUE && pkt->dts <= m_lastDts));
+
+			if (!isQueued)
+				break;
+
+			av_free_packet(pkt);
+		}
+
+		if (pkt->dts != AV_NOPTS_VALUE)
+			m_lastDts = pkt->dts;
+
+		return pkt;
+	}
+
+	int64_t SideDemuxer::getLastDts(void) const
+	{
+		return m_lastDts;
+	}
+
+} // namespace sfe
@@ -0,0 +1,78 @@
+/*
+ *  SideDemuxer.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SIDE_DEMUXER_HPP
+#define SIDE_DEMUXER_HPP
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+#include <string>
+
+namespace sfe {
+
+/* Second reader of a movie file, restricted to a single stream.
+ *
+ * Packets are read in file order by the main demuxer, thus when the streams
+ * are badly interleaved, getting the packets of one stream means queueing a
+ * lot of packets of the other one. When that queue reaches the memory budget,
+ * the starving stream is read through this demuxer instead, from where the
+ * main demuxer stopped for it, until the main demuxer catches up.
+ */
+class SideDemuxer {
+public:
+	SideDemuxer(void);
+	~SideDemuxer(void);
+
+	/* Opens @filename and positions the reading right after the packet of
+	 * @streamID whose decoding timestamp is @lastDts, or at the beginning
+	 * of the stream if @lastDts is AV_NOPTS_VALUE
+	 */
+	bool open(const std::string& filename, int streamID, int64_t lastDts);
+	void close(void);
+	bool isOpen(void) const;
+
+	/* Returns the stream read by this demuxer, -1 if it is closed
+	 */
+	int getStreamID(void) const;
+
+	/* Returns the next packet of the stream, to be freed by the caller,
+	 * or NULL at the end of the file
+	 */
+	AVPacket *read(void);
+
+	/* Returns the decoding timestamp of the last packet returned by read()
+	 */
+	int64_t getLastDts(void) const;
+
+private:
+	AVFormatContext *m_formatCtx;
+	int m_streamID;
+	int64_t m_lastDts;
+};
+
+} // namespace sfe
+
+#endif
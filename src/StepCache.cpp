@@ -0,0 +1,169 @@
+/*
+ *  StepCache.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "StepCache.hpp"
+#include "FrameBuffer.hpp"
+
+// About 16 frames of a 1080p movie
+#define DEFAULT_STEP_CACHE_CAPACITY (128 * 1024 * 1024)
+
+namespace sfe {
+
+	StepCache::StepCache(void) :
+	m_frames(),
+	m_size(0),
+	m_capacity(DEFAULT_STEP_CACHE_CAPACITY)
+	{
+	}
+
+	StepCache::~StepCache(void)
+	{
+		clear();
+	}
+
+	void StepCache::insert(sf::Time timestamp, FrameBuffer *buffer, Link link, sf::Time previous, sf::Time position)
+	{
+		EntryMap::iterator it = m_frames.find(timestamp.asMicroseconds());
+
+		if (it != m_frames.end())
+		{
+			if (it->second.link == UnknownPrevious)
+			{
+				it->second.link = link;
+				it->second.previous = previous.asMicroseconds();
+			}
+
+			buffer->release();
+			return;
+		}
+
+		Entry entry;
+		entry.buffer = buffer;
+		entry.link = link;
+		entry.previous = previous.asMicroseconds();
+
+		m_frames[timestamp.asMicroseconds()] = entry;
+		m_size += buffer->getSize();
+		trim(position);
+	}
+
+	FrameBuffer *StepCache::find(sf::Time time, sf::Time tolerance, sf::Time& timestamp) const
+	{
+		EntryMap::const_iterator it = m_frames.lower_bound((time - tolerance).asMicroseconds());
+		EntryMap::const_iterator best = m_frames.end();
+		sf::Int64 bestDistance = 0;
+
+		// Closest frame within the tolerance
+		for (; it != m_frames.end() && it->first <= (time + tolerance).asMicroseconds(); ++it)
+		{
+			sf::Int64 distance = it->first - time.asMicroseconds();
+			if (distance < 0)
+				distance = -distance;
+
+			if (best == m_frames.end() || distance < bestDistance)
+			{
+				best = it;
+				bestDistance = distance;
+			}
+		}
+
+		if (best == m_frames.end())
+			return NULL;
+
+		timestamp = sf::microseconds(best->first);
+		return best->second.buffer;
+	}
+
+	FrameBuffer *StepCache::findPrevious(sf::Time timestamp, sf::Time& previous) const
+	{
+		EntryMap::const_iterator it = m_frames.find(timestamp.asMicroseconds());
+
+		if (it == m_frames.end() || it->second.link != HasPrevious)
+			return NULL;
+
+		EntryMap::const_iterator prev = m_frames.find(it->second.previous);
+
+		if (prev == m_frames.end())
+			return NULL;
+
+		previous = sf::microseconds(prev->first);
+		return prev->second.buffer;
+	}
+
+	FrameBuffer *StepCache::findNext(sf::Time timestamp, sf::Time& next) const
+	{
+		EntryMap::const_iterator it = m_frames.upper_bound(timestamp.asMicroseconds());
+
+		if (it == m_frames.end() || it->second.link != HasPrevious ||
+			it->second.previous != timestamp.asMicroseconds())
+		{
+			return NULL;
+		}
+
+		next = sf::microseconds(it->first);
+		return it->second.buffer;
+	}
+
+	bool StepCache::isFirstFrame(sf::Time timestamp) const
+	{
+		EntryMap::const_iterator it = m_frames.find(timestamp.asMicroseconds());
+		return it != m_frames.end() && it->second.link == FirstFrame;
+	}
+
+	void StepCache::setCapacity(std::size_t bytes)
+	{
+		m_capacity = bytes;
+	}
+
+	std::size_t StepCache::getCapacity(void) const
+	{
+		return m_capacity;
+	}
+
+	void StepCache::clear(void)
+	{
+		for (EntryMap::iterator it = m_frames.begin(); it != m_frames.end(); ++it)
+			it->second.buffer->release();
+
+		m_frames.clear();
+		m_size = 0;
+	}
+
+	void StepCache::trim(sf::Time position)
+	{
+		sf::Int64 center = position.asMicroseconds();
+
+		while (m_size > m_capacity && m_frames.size() > 2)
+		{
+			// The frames are sorted, thus the farthest one is at one end
+			EntryMap::iterator first = m_frames.begin();
+			EntryMap::iterator last = --m_frames.end();
+			EntryMap::iterator farthest = (center - first->first > last->first - center) ? first : last;
+
+			m_size -= farthest->second.buffer->getSize();
+			farthest->second.buffer->release();
+			m_frames.erase(farthest);
+		}
+	}
+
+} // namespace sfe
@@ -0,0 +1,105 @@
+/*
+ *  StepCache.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef STEP_CACHE_HPP
+#define STEP_CACHE_HPP
+
+#include <SFML/System.hpp>
+#include <map>
+#include <cstddef>
+
+namespace sfe {
+
+class FrameBuffer;
+
+/* Converted RGBA frames kept around the position of a movie being stepped.
+ *
+ * Going one frame backward requires decoding from the preceding keyframe.
+ * All the frames decoded meanwhile are kept here, so that the following
+ * steps in either direction don't decode the group of pictures again.
+ *
+ * Each frame remembers the frame decoded just before it, which tells whether
+ * two cached frames are really consecutive. The total size of the frames is
+ * bounded by a capacity, the frames farthest from the stepping position are
+ * dropped first when it is exceeded.
+ */
+class StepCache {
+public:
+	enum Link {
+		UnknownPrevious,	// First frame decoded after a seek
+		FirstFrame,			// First frame of the stream
+		HasPrevious
+	};
+
+	StepCache(void);
+	~StepCache(void);
+
+	/* Keeps @buffer, taking over its reference, as the frame presented at
+	 * @timestamp. @previous is the frame decoded before it when @link is
+	 * HasPrevious. A frame already cached only gets its link completed
+	 */
+	void insert(sf::Time timestamp, FrameBuffer *buffer, Link link, sf::Time previous, sf::Time position);
+
+	/* Returns the frame presented at @time, give or take @tolerance, and its
+	 * exact timestamp, or NULL if there is none
+	 */
+	FrameBuffer *find(sf::Time time, sf::Time tolerance, sf::Time& timestamp) const;
+
+	/* Returns the frames decoded right before and right after the frame
+	 * presented at @timestamp, or NULL if they are not cached
+	 */
+	FrameBuffer *findPrevious(sf::Time timestamp, sf::Time& previous) const;
+	FrameBuffer *findNext(sf::Time timestamp, sf::Time& next) const;
+
+	/* Returns whether the frame presented at @timestamp is the first one of the stream
+	 */
+	bool isFirstFrame(sf::Time timestamp) const;
+
+	/* Maximum amount of bytes kept, the two frames closest to the stepping
+	 * position are always kept
+	 */
+	void setCapacity(std::size_t bytes);
+	std::size_t getCapacity(void) const;
+
+	void clear(void);
+
+private:
+	struct Entry {
+		FrameBuffer *buffer;
+		Link link;
+		sf::Int64 previous;	// In microseconds, valid if link is HasPrevious
+	};
+
+	typedef std::map<sf::Int64, Entry> EntryMap; // By timestamp in microseconds
+
+	// Drops the frames farthest from @position until the cache fits in its capacity
+	void trim(sf::Time position);
+
+	EntryMap m_frames;
+	std::size_t m_size;
+	std::size_t m_capacity;
+};
+
+} // namespace sfe
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ *  Thumbnailer.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "Thumbnailer.hpp"
+#include "Trace.hpp"
+#include "Log.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <vector>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+namespace sfe {
+
+	bool Thumbnailer::extract(AVFormatContext *formatCtx, int streamID, AVCodecContext *codecCtx,
+							  sf::Time time, sf::Vector2u size, sf::Image& image)
+	{
+		TRACE_SCOPE("Thumbnailer::extract");
+		AVStream *stream = formatCtx->streams[streamID];
+		int64_t target = av_rescale_q(time.asMicroseconds(), AV_TIME_BASE_Q, stream->time_base);
+
+		if (stream->start_time != AV_NOPTS_VALUE)
+			target += stream->start_time;
+
+		if (av_seek_frame(formatCtx, streamID, target, AVSEEK_FLAG_BACKWARD) < 0)
+		{
+			LOG_WARNING("Thumbnailer::extract() - unable to seek to %.3fs, using the current position", time.asSeconds());
+		}
+
+		avcodec_flush_buffers(codecCtx);
+
+		// Only the keyframe we seeked to is wanted, don't even decode the other frames
+		enum AVDiscard previousSkipFrame = codecCtx->skip_frame;
+		codecCtx->skip_frame = AVDISCARD_NONKEY;
+
+		AVFrame *frame = avcodec_alloc_frame();
+		AVPacket packet;
+		int didDecodeFrame = 0;
+		bool eof = false;
+
+		while (frame && !didDecodeFrame && !eof)
+		{
+			av_init_packet(&packet);
+
+			if (av_read_frame(formatCtx, &packet) < 0)
+			{
+				// Get the frames still delayed in the decoder
+				eof = true;
+				packet.data = NULL;
+				packet.size = 0;
+				packet.stream_index = streamID;
+			}
+
+			if (packet.stream_index == streamID)
+			{
+				if (avcodec_decode_video2(codecCtx, frame, &didDecodeFrame, &packet) < 0)
+				{
+					LOG_WARNING("Thumbnailer::extract() - an error occured while decoding the video frame");
+					didDecodeFrame = 0;
+				}
+			}
+
+			if (!eof)
+				av_free_packet(&packet);
+		}
+
+		bool success = didDecodeFrame && convert(frame, codecCtx, size, image);
+
+		codecCtx->skip_frame = previousSkipFrame;
+		avcodec_flush_buffers(codecCtx);
+
+		if (frame)
+			avcodec_free_frame(&frame);
+
+		return success;
+	}
+
+	bool Thumbnailer::extract(const std::string& filename, sf::Time time, sf::Vector2u size, sf::Image& image)
+	{
+		std::vector<sf::Time> times(1, time);
+		std::vector<sf::Image> images;
+
+		if (!extract(filename, times, size, images))
+			return false;
+
+		image = images[0];
+		return true;
+	}
+
+	bool Thumbnailer::extract(const std::string& filename, const std::vector<sf::Time>& times,
+							  sf::Vector2u size, std::vector<sf::Image>& images)
+	{
+		AVFormatContext *formatCtx = NULL;
+		int streamID = -1;
+		bool success = false;
+
+		if (!openVideoStream(filename, formatCtx, streamID))
+			return false;
+
+		AVCodecContext *codecCtx = formatCtx->streams[streamID]->codec;
+		images.resize(times.size());
+
+		for (unsigned i = 0; i < times.size(); i++)
+		{
+			images[i] = sf::Image();
+
+			if (extract(formatCtx, streamID, codecCtx, times[i], size, images[i]))
+				success = true;
+		}
+
+		avcodec_close(codecCtx);
+		avformat_close_input(&formatCtx);
+		return success;
+	}
+
+	bool Thumbnailer::extract(const std::string& filename, unsigned count,
+							  sf::Vector2u size, std::vector<sf::Image>& images)
+	{
+		AVFormatContext *formatCtx = NULL;
+		int streamID = -1;
+		bool success = false;
+
+		if (!openVideoStream(filename, formatCtx, streamID))
+			return false;
+
+		AVCodecContext *codecCtx = formatCtx->streams[streamID]->codec;
+		sf::Time duration = sf::Time::Zero;
+
+		if (formatCtx->duration != AV_NOPTS_VALUE)
+			duration = sf::microseconds(formatCtx->duration);
+
+		images.resize(count);
+
+		// Take the middle of each of the @count equal parts of the movie
+		for (unsigned i = 0; i < count; i++)
+		{
+			sf::Time time = sf::microseconds(duration.asMicroseconds() * (2 * i + 1) / (2 * count));
+			images[i] = sf::Image();
+
+			if (extract(formatCtx, streamID, codecCtx, time, size, images[i]))
+				success = true;
+		}
+
+		avcodec_close(codecCtx);
+		avformat_close_input(&formatCtx);
+		return success;
+	}
+
+	bool Thumbnailer::openVideoStream(const std::string& filename, AVFormatContext *& formatCtx, int& streamID)
+	{
+		AVCodec *codec = NULL;
+
+		initializeFFmpeg();
+
+		if (avformat_open_input(&formatCtx, filename.c_str(), NULL, NULL) != 0)
+		{
+			LOG_ERROR("Thumbnailer::openVideoStream() - unable to open file %s", filename.c_str());
+			return false;
+		}
+
+		if (avformat_find_stream_info(formatCtx, NULL) < 0)
+		{
+			LOG_ERROR("Thumbnailer::openVideoStream() - unable to read the streams of %s", filename.c_str());
+			avformat_close_input(&formatCtx);
+			return false;
+		}
+
+		streamID = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+
+		if (streamID < 0 || !codec)
+		{
+			LOG_ERROR("Thumbnailer::openVideoStream() - no decodable video stream in %s", filename.c_str());
+			avformat_close_input(&formatCtx);
+			return false;
+		}
+
+		// Demux the video stream only
+		for (unsigned i = 0; i < formatCtx->nb_streams; i++)
+		{
+			if ((int)i != streamID)
+				formatCtx->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		// Frame threading would delay the one frame we want
+		AVCodecContext *codecCtx = formatCtx->streams[streamID]->codec;
+		codecCtx->thread_count = 1;
+
+		if (avcodec_open2(codecCtx, codec, NULL) < 0)
+		{
+			LOG_ERROR("Thumbnailer::openVideoStream() - unable to load the video decoder for %s", filename.c_str());
+			avformat_close_input(&formatCtx);
+			return false;
+		}
+
+		return true;
+	}
+
+	sf::Vector2u Thumbnailer::getOutputSize(int width, int height, sf::Vector2u size)
+	{
+		if (width <= 0 || height <= 0)
+			return sf::Vector2u(0, 0);
+
+		if (size.x == 0 && size.y == 0)
+			return sf::Vector2u(width, height);
+
+		if (size.x == 0)
+			size.x = std::max(1, (int)((float)size.y * width / height + 0.5f));
+		else if (size.y == 0)
+			size.y = std::max(1, (int)((float)size.x * height / width + 0.5f));
+
+		return size;
+	}
+
+	bool Thumbnailer::convert(AVFrame *frame, AVCodecContext *codecCtx, sf::Vector2u size, sf::Image& image)
+	{
+		TRACE_SCOPE("Thumbnailer::convert");
+		size = getOutputSize(codecCtx->width, codecCtx->height, size);
+
+		if (size.x == 0 || size.y == 0)
+			return false;
+
+		// Area averaging gives the best looking downscales
+		struct SwsContext *swsCtx = sws_getContext(codecCtx->width, codecCtx->height, codecCtx->pix_fmt,
+												   size.x, size.y, PIX_FMT_RGBA,
+												   SWS_AREA, NULL, NULL, NULL);
+
+		if (!swsCtx)
+		{
+			LOG_ERROR("Thumbnailer::convert() - error with sws_getContext()");
+			return false;
+		}
+
+		std::vector<sf::Uint8> pixels(size.x * size.y * 4);
+		uint8_t *dstData[4] = {&pixels[0], NULL, NULL, NULL};
+		int dstLineSize[4] = {(int)size.x * 4, 0, 0, 0};
+
+		sws_scale(swsCtx, frame->data, frame->linesize, 0, codecCtx->height, dstData, dstLineSize);
+		sws_freeContext(swsCtx);
+
+		image.create(size.x, size.y, &pixels[0]);
+		return true;
+	}
+
+} // namespace sfe
@@ -0,0 +1,85 @@
+/*
+ *  Thumbnailer.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef THUMBNAILER_HPP
+#define THUMBNAILER_HPP
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <vector>
+
+namespace sfe {
+
+/* Extracts single images from a movie, for thumbnails.
+ *
+ * Everything is done in the calling thread: the movie is seeked to the
+ * keyframe preceding the requested time, only this keyframe is decoded and
+ * it is converted straight to RGBA at the requested size.
+ */
+class Thumbnailer {
+public:
+	/* Extracts an image from an already opened video stream. The decoder must
+	 * have been opened, and the caller must make sure no other thread reads
+	 * from @formatCtx meanwhile. The read position of @formatCtx is changed
+	 */
+	static bool extract(AVFormatContext *formatCtx, int streamID, AVCodecContext *codecCtx,
+						sf::Time time, sf::Vector2u size, sf::Image& image);
+
+	/* Opens the video stream of @filename only, extracts an image and closes the file
+	 */
+	static bool extract(const std::string& filename, sf::Time time, sf::Vector2u size, sf::Image& image);
+
+	/* Same as above for several images, the file and decoder being opened once.
+	 * Images that could not be extracted are left empty. Returns false if the
+	 * file could not be opened or no image at all could be extracted
+	 */
+	static bool extract(const std::string& filename, const std::vector<sf::Time>& times,
+						sf::Vector2u size, std::vector<sf::Image>& images);
+
+	/* Same as above for @count images evenly spaced over the movie duration
+	 */
+	static bool extract(const std::string& filename, unsigned count,
+						sf::Vector2u size, std::vector<sf::Image>& images);
+
+	/* Computes the size of the image for a @size request, where a zero
+	 * dimension is computed from the other one to keep the picture ratio
+	 */
+	static sf::Vector2u getOutputSize(int width, int height, sf::Vector2u size);
+
+private:
+	/* Opens @filename and the decoder of its best video stream, the other
+	 * streams being discarded
+	 */
+	static bool openVideoStream(const std::string& filename, AVFormatContext *& formatCtx, int& streamID);
+	static bool convert(AVFrame *frame, AVCodecContext *codecCtx, sf::Vector2u size, sf::Image& image);
+};
+
+} // namespace sfe
+
+#endif
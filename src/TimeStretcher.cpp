@@ -0,0 +1,223 @@
+/*
+ *  TimeStretcher.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "TimeStretcher.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SFE_TIME_STRETCHER_SSE
+#endif
+
+// Lengths in milliseconds, the usual values for speech and music
+#define SEQUENCE_LENGTH 40
+#define OVERLAP_LENGTH 8
+#define SEEK_LENGTH 15
+
+namespace sfe {
+
+	namespace {
+		/* Cross-correlation of @a and @b, and energy of @b. This is where the
+		 * stretching spends its time, thus it uses SSE when available
+		 */
+		void correlate(const float *a, const float *b, std::size_t count, float& product, float& energy)
+		{
+			std::size_t i = 0;
+			product = 0;
+			energy = 0;
+
+#ifdef SFE_TIME_STRETCHER_SSE
+			__m128 sumProduct = _mm_setzero_ps();
+			__m128 sumEnergy = _mm_setzero_ps();
+
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 va = _mm_loadu_ps(a + i);
+				__m128 vb = _mm_loadu_ps(b + i);
+				sumProduct = _mm_add_ps(sumProduct, _mm_mul_ps(va, vb));
+				sumEnergy = _mm_add_ps(sumEnergy, _mm_mul_ps(vb, vb));
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, sumProduct);
+			product = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			_mm_storeu_ps(lanes, sumEnergy);
+			energy = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+			for (; i < count; i++)
+			{
+				product += a[i] * b[i];
+				energy += b[i] * b[i];
+			}
+		}
+
+		sf::Int16 toSample(float value)
+		{
+			if (value > 32767.f)
+				return 32767;
+			else if (value < -32768.f)
+				return -32768;
+			else
+				return (sf::Int16)value;
+		}
+	}
+
+	TimeStretcher::TimeStretcher(void) :
+	m_channelCount(0),
+	m_sequenceLength(0),
+	m_overlapLength(0),
+	m_seekLength(0),
+	m_input(),
+	m_readPosition(0),
+	m_skipRemainder(0),
+	m_tail(),
+	m_fadeIn()
+	{
+	}
+
+	void TimeStretcher::initialize(unsigned channelCount, unsigned sampleRate)
+	{
+		m_channelCount = channelCount;
+		m_sequenceLength = sampleRate * SEQUENCE_LENGTH / 1000;
+		m_overlapLength = sampleRate * OVERLAP_LENGTH / 1000;
+		m_seekLength = sampleRate * SEEK_LENGTH / 1000;
+
+		m_fadeIn.resize(m_overlapLength * m_channelCount);
+
+		for (std::size_t i = 0; i < m_fadeIn.size(); i++)
+			m_fadeIn[i] = (i / m_channelCount + 0.5f) / m_overlapLength;
+
+		clear();
+	}
+
+	void TimeStretcher::push(const sf::Int16 *samples, std::size_t sampleCount)
+	{
+		// Drop the consumed frames once they are the larger part of the queue
+		std::size_t consumed = m_readPosition * m_channelCount;
+
+		if (consumed > 0 && consumed >= m_input.size() / 2)
+		{
+			m_input.erase(m_input.begin(), m_input.begin() + consumed);
+			m_readPosition = 0;
+		}
+
+		m_input.insert(m_input.end(), samples, samples + sampleCount);
+	}
+
+	bool TimeStretcher::process(float speed, std::vector<sf::Int16>& output)
+	{
+		if (!m_channelCount)
+			return false;
+
+		// The input advances by the output length times the speed
+		std::size_t outputLength = m_sequenceLength - m_overlapLength;
+		float skip = outputLength * speed + m_skipRemainder;
+		std::size_t skipLength = (std::size_t)skip;
+		std::size_t neededLength = std::max(m_seekLength + m_sequenceLength, skipLength);
+
+		if (m_input.size() / m_channelCount < m_readPosition + neededLength)
+			return false;
+
+		const float *sequence = &m_input[(m_readPosition + findBestOffset()) * m_channelCount];
+		std::size_t overlapCount = m_overlapLength * m_channelCount;
+		std::size_t outputCount = outputLength * m_channelCount;
+		std::size_t first = output.size();
+		output.resize(first + outputCount);
+		sf::Int16 *out = &output[first];
+
+		if (m_tail.empty())
+		{
+			for (std::size_t i = 0; i < overlapCount; i++)
+				out[i] = toSample(sequence[i]);
+		}
+		else
+		{
+			for (std::size_t i = 0; i < overlapCount; i++)
+				out[i] = toSample(m_tail[i] + (sequence[i] - m_tail[i]) * m_fadeIn[i]);
+		}
+
+		for (std::size_t i = overlapCount; i < outputCount; i++)
+			out[i] = toSample(sequence[i]);
+
+		m_tail.assign(sequence + outputCount, sequence + outputCount + overlapCount);
+		m_readPosition += skipLength;
+		m_skipRemainder = skip - skipLength;
+
+		return true;
+	}
+
+	void TimeStretcher::flush(std::vector<sf::Int16>& output)
+	{
+		for (std::size_t i = 0; i < m_tail.size(); i++)
+			output.push_back(toSample(m_tail[i]));
+
+		for (std::size_t i = m_readPosition * m_channelCount; i < m_input.size(); i++)
+			output.push_back(toSample(m_input[i]));
+
+		clear();
+	}
+
+	bool TimeStretcher::isEmpty(void) const
+	{
+		return m_tail.empty() && m_input.size() <= m_readPosition * m_channelCount;
+	}
+
+	void TimeStretcher::clear(void)
+	{
+		m_input.clear();
+		m_readPosition = 0;
+		m_skipRemainder = 0;
+		m_tail.clear();
+	}
+
+	std::size_t TimeStretcher::findBestOffset(void) const
+	{
+		if (m_tail.empty())
+			return 0;
+
+		// Normalized cross-correlation, so that louder candidates are not favoured
+		std::size_t bestOffset = 0;
+		float bestScore = 0;
+
+		for (std::size_t offset = 0; offset < m_seekLength; offset++)
+		{
+			float product;
+			float energy;
+			correlate(&m_tail[0], &m_input[(m_readPosition + offset) * m_channelCount],
+					  m_tail.size(), product, energy);
+
+			float score = (energy > 0) ? product / std::sqrt(energy) : 0;
+
+			if (offset == 0 || score > bestScore)
+			{
+				bestScore = score;
+				bestOffset = offset;
+			}
+		}
+
+		return bestOffset;
+	}
+
+} // namespace sfe
@@ -0,0 +1,81 @@
+/*
+ *  TimeStretcher.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef TIME_STRETCHER_HPP
+#define TIME_STRETCHER_HPP
+
+#include <SFML/System.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace sfe {
+
+/* Changes the speed of interleaved 16 bits audio without changing its pitch.
+ *
+ * This is a waveform similarity overlap-add (WSOLA): the output is made of
+ * sequences of the input, taken further apart from each other than they are
+ * output when speeding up, closer when slowing down. Each sequence is moved
+ * by a few milliseconds to where it best matches the end of the previous one,
+ * then cross-faded with it, so that the waveforms join without any click.
+ */
+class TimeStretcher {
+public:
+	TimeStretcher(void);
+
+	void initialize(unsigned channelCount, unsigned sampleRate);
+
+	/* Queues @sampleCount samples, @samples being interleaved
+	 */
+	void push(const sf::Int16 *samples, std::size_t sampleCount);
+
+	/* Appends one sequence played at @speed to @output, returns false
+	 * without doing anything if more samples must be pushed first
+	 */
+	bool process(float speed, std::vector<sf::Int16>& output);
+
+	/* Appends all the queued samples to @output without stretching them,
+	 * then clears the stretcher
+	 */
+	void flush(std::vector<sf::Int16>& output);
+
+	bool isEmpty(void) const;
+	void clear(void);
+
+private:
+	// Position in the input of the sequence that best continues m_tail
+	std::size_t findBestOffset(void) const;
+
+	unsigned m_channelCount;
+	std::size_t m_sequenceLength;	// In frames (one sample per channel)
+	std::size_t m_overlapLength;
+	std::size_t m_seekLength;
+	std::vector<float> m_input;
+	std::size_t m_readPosition;		// First input frame not consumed yet
+	float m_skipRemainder;			// Fraction of frame to skip with the next sequence
+	std::vector<float> m_tail;		// End of the previous sequence, faded out by the next one
+	std::vector<float> m_fadeIn;	// Cross-fade weights, for each sample of m_tail
+};
+
+} // namespace sfe
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ *  Trace.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "Trace.hpp"
+#include "Log.hpp"
+#include <cstdio>
+#include <vector>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Maximum amount of spans kept for one thread between two saves
+#define TRACE_MAX_EVENTS_PER_THREAD 1000000
+
+namespace sfe {
+
+	namespace {
+		struct TraceEvent {
+			const char *name;
+			sf::Int64 start;
+			sf::Int64 duration;
+		};
+
+		// Spans recorded by one thread. Only the owner thread appends to it, the mutex
+		// is only contended while saving
+		struct ThreadBuffer {
+			unsigned threadId;
+			const char *threadName;
+			std::vector<TraceEvent> events;
+			unsigned droppedEvents;
+			sf::Mutex mutex;
+		};
+
+		bool g_tracingEnabled = false;
+		sf::Clock g_traceClock;
+		sf::Mutex g_buffersMutex;
+		std::vector<ThreadBuffer *> g_buffers;
+		THREAD_LOCAL ThreadBuffer *t_buffer = NULL;
+
+		ThreadBuffer& threadBuffer(void)
+		{
+			if (!t_buffer)
+			{
+				sf::Lock l(g_buffersMutex);
+				t_buffer = new ThreadBuffer;
+				t_buffer->threadId = g_buffers.size() + 1;
+				t_buffer->threadName = NULL;
+				t_buffer->droppedEvents = 0;
+				g_buffers.push_back(t_buffer);
+			}
+
+			return *t_buffer;
+		}
+
+		void writeJSONString(FILE *file, const char *str)
+		{
+			fputc('"', file);
+			for (; *str; str++)
+			{
+				if (*str == '"' || *str == '\\')
+					fputc('\\', file);
+				fputc(*str, file);
+			}
+			fputc('"', file);
+		}
+	}
+
+	Trace::Scope::Scope(const char *name) :
+	m_name(g_tracingEnabled ? name : NULL),
+	m_start(m_name ? now() : 0)
+	{
+	}
+
+	Trace::Scope::~Scope(void)
+	{
+		if (m_name)
+			record(m_name, m_start, now());
+	}
+
+	void Trace::setEnabled(bool flag)
+	{
+		g_tracingEnabled = flag;
+	}
+
+	bool Trace::isEnabled(void)
+	{
+		return g_tracingEnabled;
+	}
+
+	void Trace::setThreadName(const char *name)
+	{
+		if (!g_tracingEnabled)
+			return;
+
+		ThreadBuffer& buffer = threadBuffer();
+		sf::Lock l(buffer.mutex);
+		buffer.threadName = name;
+	}
+
+	void Trace::record(const char *name, sf::Int64 start, sf::Int64 end)
+	{
+		ThreadBuffer& buffer = threadBuffer();
+		sf::Lock l(buffer.mutex);
+
+		if (buffer.events.size() < TRACE_MAX_EVENTS_PER_THREAD)
+		{
+			TraceEvent event = {name, start, end - start};
+			buffer.events.push_back(event);
+		}
+		else
+		{
+			buffer.droppedEvents++;
+		}
+	}
+
+	sf::Int64 Trace::now(void)
+	{
+		return g_traceClock.getElapsedTime().asMicroseconds();
+	}
+
+	bool Trace::save(const std::string& filename)
+	{
+		FILE *file = fopen(filename.c_str(), "w");
+
+		if (!file)
+			return false;
+
+		sf::Lock l(g_buffersMutex);
+		bool first = true;
+
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+		for (unsigned i = 0; i < g_buffers.size(); i++)
+		{
+			ThreadBuffer& buffer = *g_buffers[i];
+			sf::Lock bl(buffer.mutex);
+
+			if (buffer.threadName)
+			{
+				fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+						first ? "" : ",\n", buffer.threadId);
+				writeJSONString(file, buffer.threadName);
+				fprintf(file, "}}");
+				first = false;
+			}
+
+			for (unsigned j = 0; j < buffer.events.size(); j++)
+			{
+				const TraceEvent& event = buffer.events[j];
+				fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+				writeJSONString(file, event.name);
+				fprintf(file, ",\"cat\":\"sfeMovie\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+						buffer.threadId, (long long)event.start, (long long)event.duration);
+				first = false;
+			}
+
+			if (buffer.droppedEvents)
+			{
+				LOG_WARNING("Trace::save() - %u spans dropped on thread %u because its buffer was full",
+							buffer.droppedEvents, buffer.threadId);
+			}
+
+			buffer.events.clear();
+			buffer.droppedEvents = 0;
+		}
+
+		fprintf(file, "\n]}\n");
+		return 0 == fclose(file);
+	}
+
+} // namespace sfe
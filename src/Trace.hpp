@@ -0,0 +1,85 @@
+/*
+ *  Trace.hpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <SFML/System.hpp>
+#include <string>
+
+namespace sfe {
+
+/* Timeline recorder for the decoding, conversion and upload steps.
+ *
+ * Spans are appended to a buffer owned by the calling thread so that threads
+ * don't contend with each other while recording. When tracing is disabled,
+ * a span costs a single flag check.
+ *
+ * The recorded spans are exported in the Chrome trace event format, which
+ * can be loaded in chrome://tracing or https://ui.perfetto.dev
+ */
+class Trace {
+public:
+	/* Records the span between its construction and destruction
+	 */
+	class Scope {
+	public:
+		Scope(const char *name);
+		~Scope(void);
+
+	private:
+		const char *m_name;
+		sf::Int64 m_start;
+	};
+
+	static void setEnabled(bool flag);
+	static bool isEnabled(void);
+
+	/* Names the calling thread in the exported timeline
+	 * Does nothing if tracing is disabled
+	 * @name must be a string literal
+	 */
+	static void setThreadName(const char *name);
+
+	/* Writes the spans recorded so far to @filename and clears them
+	 *
+	 * @return true on success, false if the file couldn't be written
+	 */
+	static bool save(const std::string& filename);
+
+	/* Records a span of @name from @start to @end (microseconds on the trace clock)
+	 * @name must be a string literal
+	 */
+	static void record(const char *name, sf::Int64 start, sf::Int64 end);
+
+	/* Returns the current time on the trace clock, in microseconds
+	 */
+	static sf::Int64 now(void);
+};
+
+} // namespace sfe
+
+// Records a span covering the rest of the enclosing block
+#define TRACE_SCOPE(name) sfe::Trace::Scope __trace_scope(name)
+
+#endif
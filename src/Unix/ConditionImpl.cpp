@@ -22,11 +22,13 @@
  *
  */
 
-
 #include "ConditionImpl.hpp"
-#include <sfeMovie/Movie.hpp>
-#include <iostream>
-using namespace std;
+#include "../Atomic.hpp"
+#include "../Log.hpp"
+#include <SFML/System/Clock.hpp>
+#include <time.h>
+#include <errno.h>
+#include <algorithm>
 
 namespace sfe {
 
@@ -36,23 +38,34 @@ m_conditionnedVar(var),
 m_cond(),
 m_mutex()
 {
+#ifdef __APPLE__
+	// The timed waits are relative there, see waitAndRetain()
 	if (0 != pthread_cond_init(&m_cond, NULL))
-		cerr << "pthread_cond_init() error\n";
+		LOG_ERROR("pthread_cond_init() error");
+#else
+	// The timed waits must not move with the system clock
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	
+	if (0 != pthread_cond_init(&m_cond, &attr))
+		LOG_ERROR("pthread_cond_init() error");
+	
+	pthread_condattr_destroy(&attr);
+#endif
 	
 	if (0 != pthread_mutex_init(&m_mutex, NULL))
-		cerr << "pthread_mutex_init() error\n";
+		LOG_ERROR("pthread_mutex_init() error");
 }
 
 
 ConditionImpl::~ConditionImpl(void)
 {
-	if (0 != pthread_mutex_destroy(&m_mutex) &&
-		Movie::usesDebugMessages())
-		cerr << "pthread_mutex_destroy() error\n";
+	if (0 != pthread_mutex_destroy(&m_mutex))
+		LOG_DEBUG("pthread_mutex_destroy() error");
 	
-	if (0 != pthread_cond_destroy(&m_cond) &&
-		Movie::usesDebugMessages())
-		cerr << "pthread_cond_destroy() error\n";
+	if (0 != pthread_cond_destroy(&m_cond))
+		LOG_DEBUG("pthread_cond_destroy() error");
 }
 	
 void ConditionImpl::lock(void)
@@ -69,28 +82,59 @@ bool ConditionImpl::waitAndRetain(int value)
 {
 	pthread_mutex_lock(&m_mutex);
 	
-	/*if (m_conditionnedVar == value && m_isValid)
-	{
-		MT_COUT(std::cout << "cond " << (unsigned)this%1000 << " DIRECTLY validated\n");
-	}*/
-	
 	while (m_conditionnedVar != value && m_isValid)
-	{
-		//MT_COUT(std::cout << "will wait cond " << (unsigned)this%1000 << " (expected " << value << ")\n");
 		pthread_cond_wait(&m_cond, &m_mutex);
-	}
 	
 	if (m_isValid)
-	{
-		//MT_COUT(std::cout << "cond " << (unsigned)this%1000 << " validated\n");
 		return true;
-	}
-	else
+	
+	pthread_mutex_unlock(&m_mutex);
+	return false;
+}
+
+bool ConditionImpl::waitAndRetain(int value, sf::Time timeout)
+{
+	sf::Int64 wantedWait = std::max(timeout.asMicroseconds(), (sf::Int64)0);
+	
+#ifdef __APPLE__
+	// pthread_condattr_setclock() is missing, the relative wait doesn't depend
+	// on the system clock
+	sf::Clock clock;
+	
+	pthread_mutex_lock(&m_mutex);
+	
+	int res = 0;
+	while (m_conditionnedVar != value && m_isValid && res != ETIMEDOUT)
 	{
-		//MT_COUT(std::cout << "invalid condition\n");
-		pthread_mutex_unlock(&m_mutex);
-		return false;
+		sf::Int64 remaining = std::max(wantedWait - clock.getElapsedTime().asMicroseconds(), (sf::Int64)0);
+		struct timespec remainingSpec;
+		remainingSpec.tv_sec = remaining / 1000000;
+		remainingSpec.tv_nsec = (remaining % 1000000) * 1000;
+		
+		res = pthread_cond_timedwait_relative_np(&m_cond, &m_mutex, &remainingSpec);
 	}
+#else
+	// pthread_cond_timedwait() takes an absolute time on the condition's clock
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	sf::Int64 deadline = (sf::Int64)now.tv_sec * 1000000 + now.tv_nsec / 1000 + wantedWait;
+	struct timespec deadlineSpec;
+	deadlineSpec.tv_sec = deadline / 1000000;
+	deadlineSpec.tv_nsec = (deadline % 1000000) * 1000;
+	
+	pthread_mutex_lock(&m_mutex);
+	
+	int res = 0;
+	while (m_conditionnedVar != value && m_isValid && res != ETIMEDOUT)
+		res = pthread_cond_timedwait(&m_cond, &m_mutex, &deadlineSpec);
+#endif
+	
+	if (m_isValid && m_conditionnedVar == value)
+		return true;
+	
+	pthread_mutex_unlock(&m_mutex);
+	return false;
 }
 
 void ConditionImpl::release(int value)
@@ -105,7 +149,6 @@ void ConditionImpl::setValue(int value)
 {
 	// Make sure the Condition's value is not modified while retained
 	pthread_mutex_lock(&m_mutex);
-	//MT_COUT(std::cout << "cond " << (unsigned)this%1000 << " set to " << value << std::endl);
 	m_conditionnedVar = value;
 	pthread_mutex_unlock(&m_mutex);
 	
@@ -114,7 +157,7 @@ void ConditionImpl::setValue(int value)
 
 int ConditionImpl::value(void) const
 {
-	return m_conditionnedVar;
+	return atomicLoad(const_cast<volatile long *>(&m_conditionnedVar));
 }
 
 void ConditionImpl::signal(void)
@@ -122,23 +165,31 @@ void ConditionImpl::signal(void)
 	pthread_cond_signal(&m_cond);
 }
 
+void ConditionImpl::broadcast(void)
+{
+	pthread_cond_broadcast(&m_cond);
+}
+
 
 void ConditionImpl::invalidate(void)
 {
-	if (m_isValid)
-	{
-		m_isValid = false;
-		signal();
-	}
+	// The flag is changed with the mutex held so that a thread that just
+	// checked it can't miss the wake up
+	pthread_mutex_lock(&m_mutex);
+	bool wasValid = m_isValid;
+	m_isValid = false;
+	pthread_mutex_unlock(&m_mutex);
+	
+	if (wasValid)
+		broadcast();
 }
 
 
 void ConditionImpl::restore(void)
 {
-	if (!m_isValid)
-	{
-		m_isValid = true;
-	}
+	pthread_mutex_lock(&m_mutex);
+	m_isValid = true;
+	pthread_mutex_unlock(&m_mutex);
 }
 
 } // namespace sfe
@@ -27,6 +27,7 @@
 #define CONDITION_IMPL_HPP
 
 #include <pthread.h>
+#include <SFML/System/Time.hpp>
 
 namespace sfe {
 
@@ -38,16 +39,18 @@ public:
 	void lock(void);
 	void unlock(void);
 	bool waitAndRetain(int value);
+	bool waitAndRetain(int value, sf::Time timeout);
 	void release(int value);
 	void setValue(int value);
 	int value(void) const;
 	void signal(void);
+	void broadcast(void);
 	void invalidate(void);
 	void restore(void);
 	
 private:
 	int m_isValid;
-	int m_conditionnedVar;
+	volatile long m_conditionnedVar;
 	pthread_cond_t m_cond;
 	pthread_mutex_t m_mutex;
 };
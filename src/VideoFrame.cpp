@@ -0,0 +1,142 @@
+/*
+ *  VideoFrame.cpp
+ *  sfeMovie project
+ *
+ *  Copyright (C) 2010-2012 Lucas Soltic
+ *  soltic.lucas@gmail.com
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <sfeMovie/VideoFrame.hpp>
+#include "FrameBuffer.hpp"
+
+namespace sfe {
+
+	VideoFrame::VideoFrame(void) :
+	m_pixelFormat(PIX_FMT_NONE),
+	m_size(0, 0),
+	m_timestamp(sf::Time::Zero),
+	m_buffer(NULL)
+	{
+		for (int i = 0; i < MaxPlanes; i++)
+		{
+			m_data[i] = NULL;
+			m_lineSize[i] = 0;
+		}
+	}
+
+	VideoFrame::VideoFrame(const VideoFrame& other) :
+	m_pixelFormat(PIX_FMT_NONE),
+	m_size(0, 0),
+	m_timestamp(sf::Time::Zero),
+	m_buffer(NULL)
+	{
+		*this = other;
+	}
+
+	VideoFrame& VideoFrame::operator=(const VideoFrame& other)
+	{
+		if (this == &other)
+			return *this;
+
+		reset();
+
+		m_pixelFormat = other.m_pixelFormat;
+		m_size = other.m_size;
+		m_timestamp = other.m_timestamp;
+
+		if (other.m_buffer)
+		{
+			m_buffer = other.m_buffer;
+			m_buffer->retain();
+		}
+		else if (other.isValid())
+		{
+			// The planes belong to the decoder and won't outlive the sink call
+			m_buffer = FrameBuffer::copy(other.m_data, other.m_lineSize,
+										 (enum PixelFormat)m_pixelFormat, m_size.x, m_size.y);
+		}
+
+		if (m_buffer)
+		{
+			for (int i = 0; i < MaxPlanes; i++)
+			{
+				m_data[i] = (other.m_buffer) ? other.m_data[i] : m_buffer->data[i];
+				m_lineSize[i] = (other.m_buffer) ? other.m_lineSize[i] : m_buffer->lineSize[i];
+			}
+		}
+		else
+		{
+			m_pixelFormat = PIX_FMT_NONE;
+			m_size = sf::Vector2i(0, 0);
+		}
+
+		return *this;
+	}
+
+	VideoFrame::~VideoFrame(void)
+	{
+		reset();
+	}
+
+	bool VideoFrame::isValid(void) const
+	{
+		return m_data[0] != NULL;
+	}
+
+	const sf::Uint8 *VideoFrame::getData(unsigned plane) const
+	{
+		return (plane < MaxPlanes) ? m_data[plane] : NULL;
+	}
+
+	int VideoFrame::getLineSize(unsigned plane) const
+	{
+		return (plane < MaxPlanes) ? m_lineSize[plane] : 0;
+	}
+
+	int VideoFrame::getPixelFormat(void) const
+	{
+		return m_pixelFormat;
+	}
+
+	sf::Vector2i VideoFrame::getSize(void) const
+	{
+		return m_size;
+	}
+
+	sf::Time VideoFrame::getTimestamp(void) const
+	{
+		return m_timestamp;
+	}
+
+	void VideoFrame::reset(void)
+	{
+		if (m_buffer)
+			m_buffer->release(), m_buffer = NULL;
+
+		for (int i = 0; i < MaxPlanes; i++)
+		{
+			m_data[i] = NULL;
+			m_lineSize[i] = 0;
+		}
+
+		m_pixelFormat = PIX_FMT_NONE;
+		m_size = sf::Vector2i(0, 0);
+		m_timestamp = sf::Time::Zero;
+	}
+
+} // namespace sfe
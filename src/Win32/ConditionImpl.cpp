@@ -23,19 +23,24 @@
  */
 
 #include "ConditionImpl.hpp"
-#include <iostream>
+#include "../Atomic.hpp"
+#include "../Log.hpp"
+#include <climits>
 
 namespace sfe {
 
 ConditionImpl::ConditionImpl(int var) :
 m_isValid(true),
 m_conditionnedVar(var),
+m_waiterCount(0),
 m_mutex()
 {
-	m_cond = CreateEvent(NULL, FALSE, FALSE, NULL);
+	// A semaphore rather than an event so that broadcast() can wake up
+	// every waiting thread
+	m_cond = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
 	
 	if (m_cond == NULL)
-		std::cerr << "ConditionImpl() - CreateEvent() error\n";
+		LOG_ERROR("ConditionImpl() - CreateSemaphore() error");
 }
 
 ConditionImpl::~ConditionImpl(void)
@@ -59,9 +64,11 @@ bool ConditionImpl::waitAndRetain(int value)
 	
 	while (m_conditionnedVar != value && m_isValid)
 	{
+		m_waiterCount++;
 		m_mutex.unlock();
 		WaitForSingleObject(m_cond, INFINITE);
 		m_mutex.lock();
+		m_waiterCount--;
 	}
 	
 	if (m_isValid)
@@ -73,6 +80,40 @@ bool ConditionImpl::waitAndRetain(int value)
 	}
 }
 
+bool ConditionImpl::waitAndRetain(int value, sf::Time timeout)
+{
+	sf::Int32 milliseconds = timeout.asMilliseconds();
+	DWORD deadline = GetTickCount() + (milliseconds > 0 ? milliseconds : 0);
+	bool didTimeOut = false;
+	
+	m_mutex.lock();
+	
+	while (m_conditionnedVar != value && m_isValid && !didTimeOut)
+	{
+		// Wrapping safe difference
+		long remaining = (long)(deadline - GetTickCount());
+		
+		if (remaining <= 0)
+		{
+			didTimeOut = true;
+		}
+		else
+		{
+			m_waiterCount++;
+			m_mutex.unlock();
+			WaitForSingleObject(m_cond, remaining);
+			m_mutex.lock();
+			m_waiterCount--;
+		}
+	}
+	
+	if (m_isValid && m_conditionnedVar == value)
+		return true;
+	
+	m_mutex.unlock();
+	return false;
+}
+
 void ConditionImpl::release(int value)
 {
 	m_conditionnedVar = value;
@@ -93,28 +134,48 @@ void ConditionImpl::setValue(int value)
 	
 int ConditionImpl::value(void) const
 {
-	return m_conditionnedVar;
+	return atomicLoad(const_cast<volatile long *>(&m_conditionnedVar));
 }
 
 void ConditionImpl::signal(void)
 {
-	SetEvent(m_cond);
+	m_mutex.lock();
+	
+	// Extra releases are harmless, the waiting loops check the value again
+	if (m_waiterCount > 0)
+		ReleaseSemaphore(m_cond, 1, NULL);
+	
+	m_mutex.unlock();
+}
+
+void ConditionImpl::broadcast(void)
+{
+	m_mutex.lock();
+	
+	if (m_waiterCount > 0)
+		ReleaseSemaphore(m_cond, m_waiterCount, NULL);
+	
+	m_mutex.unlock();
 }
 
 void ConditionImpl::invalidate(void)
 {
-	if (m_isValid)
-	{
-		m_isValid = false;
-		signal();
-	}
+	// The flag is changed with the mutex held so that a thread that just
+	// checked it can't miss the wake up
+	m_mutex.lock();
+	bool wasValid = m_isValid != 0;
+	m_isValid = false;
+	m_mutex.unlock();
+	
+	if (wasValid)
+		broadcast();
 }
+
 void ConditionImpl::restore(void)
 {
-	if (!m_isValid)
-	{
-		m_isValid = true;
-	}
+	m_mutex.lock();
+	m_isValid = true;
+	m_mutex.unlock();
 }
 
 } // namespace sfe
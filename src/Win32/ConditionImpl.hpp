@@ -38,17 +38,20 @@ public:
 	void lock(void);
 	void unlock(void);
 	bool waitAndRetain(int value);
+	bool waitAndRetain(int value, sf::Time timeout);
 	void release(int value);
 	void setValue(int value);
 	int value(void) const;
 	void signal(void);
+	void broadcast(void);
 	void invalidate(void);
 	void restore(void);
 	
 private:
 	int m_isValid;
-	int m_conditionnedVar;
-	HANDLE m_cond;
+	volatile long m_conditionnedVar;
+	long m_waiterCount;				// Threads waiting on m_cond, protected by m_mutex
+	HANDLE m_cond;					// Semaphore released once per thread to wake up
 	sf::Mutex m_mutex;
 };
 	
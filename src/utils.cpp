@@ -27,6 +27,12 @@
 #include <iostream>
 #include <cstdio>
 
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
 sf::Mutex __mtx;
 
 static sf::Mutex printWithTimeMutex;
@@ -48,3 +54,54 @@ void output_thread(void)
 {
 	//std::cout << "Thread " << (unsigned)pthread_self() % 1000 << ": ";
 }
+
+static int lockManager(void **mutex, enum AVLockOp op)
+{
+	switch (op)
+	{
+		case AV_LOCK_CREATE:
+			*mutex = new sf::Mutex;
+			break;
+		case AV_LOCK_OBTAIN:
+			static_cast<sf::Mutex *>(*mutex)->lock();
+			break;
+		case AV_LOCK_RELEASE:
+			static_cast<sf::Mutex *>(*mutex)->unlock();
+			break;
+		case AV_LOCK_DESTROY:
+			delete static_cast<sf::Mutex *>(*mutex);
+			*mutex = NULL;
+			break;
+	}
+
+	return 0;
+}
+
+void initializeFFmpeg(void)
+{
+	static sf::Mutex initMutex;
+	static bool initialized = false;
+	sf::Lock l(initMutex);
+
+	if (!initialized)
+	{
+		av_register_all();
+		av_lockmgr_register(&lockManager);
+		initialized = true;
+	}
+}
+
+AVPacket *allocFlushPacket(void)
+{
+	AVPacket *pkt = (AVPacket *)av_malloc(sizeof(*pkt));
+	av_init_packet(pkt);
+	pkt->data = NULL;
+	pkt->size = 0;
+	return pkt;
+}
+
+bool isFlushPacket(const AVPacket *pkt)
+{
+	// Demuxed packets always have data
+	return pkt->data == NULL && pkt->size == 0;
+}
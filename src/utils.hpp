@@ -29,6 +29,11 @@
 #include <sstream>
 #include <SFML/System.hpp>
 
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
 #define ONCE(sequence)\
 { static bool __done = false; if (!__done) { { sequence; } __done = true; } }
 
@@ -37,6 +42,15 @@
 
 void printWithTime(const std::string& msg);
 
+// Registers the FFmpeg formats and codecs, and the lock manager that lets
+// decoders be opened from several threads at the same time
+void initializeFFmpeg(void);
+
+// Empty packet queued when the read position jumps (eg. when looping): the
+// decoders output their delayed frames and are reset when they reach it
+AVPacket *allocFlushPacket(void);
+bool isFlushPacket(const AVPacket *pkt);
+
 template <typename T>
 std::string s(const T& v)
 {
@@ -0,0 +1,307 @@
+
+#include <SFML/Graphics.hpp>
+#include <sfeMovie/Movie.hpp>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef SFML_SYSTEM_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/*
+ * Generates one contact sheet per movie file: a grid of thumbnails evenly
+ * spaced over the movie duration.
+ *
+ * The files are distributed over a pool of worker threads, each file being
+ * opened only once for all its thumbnails. The time spent on each file and
+ * the overall throughput are reported.
+ */
+
+struct Options {
+	Options(void) :
+	thumbnailCount(9),
+	thumbnailWidth(256),
+	columns(3),
+	jobs(4),
+	outputDir(".")
+	{
+	}
+
+	unsigned thumbnailCount;
+	unsigned thumbnailWidth;
+	unsigned columns;
+	unsigned jobs;
+	std::string outputDir;
+};
+
+static const unsigned sheetSpacing = 4;
+
+static bool isDirectory(const std::string& path)
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+static void listDirectory(const std::string& path, std::vector<std::string>& files)
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	WIN32_FIND_DATAA entry;
+	HANDLE handle = FindFirstFileA((path + "\\*").c_str(), &entry);
+
+	if (handle == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			files.push_back(path + "\\" + entry.cFileName);
+	} while (FindNextFileA(handle, &entry));
+
+	FindClose(handle);
+#else
+	DIR *dir = opendir(path.c_str());
+
+	if (!dir)
+		return;
+
+	while (struct dirent *entry = readdir(dir))
+	{
+		std::string file = path + "/" + entry->d_name;
+
+		if (entry->d_name[0] != '.' && !isDirectory(file))
+			files.push_back(file);
+	}
+
+	closedir(dir);
+#endif
+}
+
+static std::string baseName(const std::string& path)
+{
+	std::string::size_type slash = path.find_last_of("/\\");
+	std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+	std::string::size_type dot = name.find_last_of('.');
+
+	return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+class ThumbnailJobs {
+public:
+	ThumbnailJobs(const std::vector<std::string>& files, const Options& options) :
+	m_files(files),
+	m_options(options),
+	m_nextFile(0),
+	m_succeeded(0),
+	m_thumbnails(0),
+	m_mutex()
+	{
+	}
+
+	void run(void)
+	{
+		std::string file;
+
+		while (nextFile(file))
+		{
+			sf::Clock timer;
+			std::vector<sf::Image> thumbnails;
+			bool success = sfe::Movie::extractFrames(file, m_options.thumbnailCount,
+													 sf::Vector2u(m_options.thumbnailWidth, 0), thumbnails);
+			sf::Time extractionTime = timer.getElapsedTime();
+			unsigned extracted = 0;
+			std::string output;
+
+			if (success)
+			{
+				output = m_options.outputDir + "/" + baseName(file) + ".png";
+				extracted = saveContactSheet(thumbnails, output);
+				success = extracted > 0;
+			}
+
+			sf::Lock l(m_mutex);
+
+			if (success)
+			{
+				m_succeeded++;
+				m_thumbnails += extracted;
+				std::printf("%-50s %2u thumbnails  extract %7.1fms  total %7.1fms  -> %s\n", file.c_str(), extracted,
+							extractionTime.asSeconds() * 1000, timer.getElapsedTime().asSeconds() * 1000, output.c_str());
+			}
+			else
+			{
+				std::printf("%-50s failed after %.1fms\n", file.c_str(), timer.getElapsedTime().asSeconds() * 1000);
+			}
+		}
+	}
+
+	unsigned getSucceededCount(void) const
+	{
+		return m_succeeded;
+	}
+
+	unsigned getThumbnailCount(void) const
+	{
+		return m_thumbnails;
+	}
+
+private:
+	bool nextFile(std::string& file)
+	{
+		sf::Lock l(m_mutex);
+
+		if (m_nextFile >= m_files.size())
+			return false;
+
+		file = m_files[m_nextFile++];
+		return true;
+	}
+
+	unsigned saveContactSheet(const std::vector<sf::Image>& thumbnails, const std::string& output)
+	{
+		sf::Vector2u cellSize(0, 0);
+		unsigned extracted = 0;
+
+		for (unsigned i = 0; i < thumbnails.size(); i++)
+		{
+			cellSize.x = std::max(cellSize.x, thumbnails[i].getSize().x);
+			cellSize.y = std::max(cellSize.y, thumbnails[i].getSize().y);
+		}
+
+		unsigned columns = std::min(m_options.columns, (unsigned)thumbnails.size());
+		unsigned rows = (thumbnails.size() + columns - 1) / columns;
+		sf::Image sheet;
+		sheet.create(columns * (cellSize.x + sheetSpacing) + sheetSpacing,
+					 rows * (cellSize.y + sheetSpacing) + sheetSpacing, sf::Color::Black);
+
+		for (unsigned i = 0; i < thumbnails.size(); i++)
+		{
+			if (thumbnails[i].getSize().x == 0)
+				continue;
+
+			sheet.copy(thumbnails[i],
+					   sheetSpacing + (i % columns) * (cellSize.x + sheetSpacing),
+					   sheetSpacing + (i / columns) * (cellSize.y + sheetSpacing));
+			extracted++;
+		}
+
+		if (extracted && !sheet.saveToFile(output))
+			return 0;
+
+		return extracted;
+	}
+
+	const std::vector<std::string>& m_files;
+	const Options& m_options;
+	unsigned m_nextFile;
+	unsigned m_succeeded;
+	unsigned m_thumbnails;
+	sf::Mutex m_mutex;
+};
+
+static void usage(const char *program)
+{
+	std::cout << "Usage: " << program << " [options] <file | directory | @list_file>..." << std::endl;
+	std::cout << "  -n count    thumbnails per file (default 9)" << std::endl;
+	std::cout << "  -w width    thumbnail width in pixels (default 256)" << std::endl;
+	std::cout << "  -c columns  thumbnails per row of the contact sheet (default 3)" << std::endl;
+	std::cout << "  -j jobs     files processed in parallel (default 4)" << std::endl;
+	std::cout << "  -o dir      directory of the contact sheets (default .)" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	Options options;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if (arg.empty())
+			continue;
+
+		if (arg.size() == 2 && arg[0] == '-')
+		{
+			// Every option takes a value
+			if (i + 1 >= argc)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+
+			const char *value = argv[++i];
+
+			switch (arg[1])
+			{
+				case 'n': options.thumbnailCount = std::max(1, std::atoi(value)); break;
+				case 'w': options.thumbnailWidth = std::max(1, std::atoi(value)); break;
+				case 'c': options.columns = std::max(1, std::atoi(value)); break;
+				case 'j': options.jobs = std::max(1, std::atoi(value)); break;
+				case 'o': options.outputDir = value; break;
+				default: usage(argv[0]); return 1;
+			}
+		}
+		else if (arg[0] == '@')
+		{
+			std::ifstream list(arg.c_str() + 1);
+			std::string line;
+
+			while (std::getline(list, line))
+			{
+				if (!line.empty())
+					files.push_back(line);
+			}
+		}
+		else if (isDirectory(arg))
+		{
+			listDirectory(arg, files);
+		}
+		else
+		{
+			files.push_back(arg);
+		}
+	}
+
+	if (files.empty())
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	ThumbnailJobs jobs(files, options);
+	std::vector<sf::Thread *> workers;
+	sf::Clock timer;
+
+	for (unsigned i = 0; i < std::min(options.jobs, (unsigned)files.size()); i++)
+	{
+		workers.push_back(new sf::Thread(&ThumbnailJobs::run, &jobs));
+		workers.back()->launch();
+	}
+
+	for (unsigned i = 0; i < workers.size(); i++)
+	{
+		workers[i]->wait();
+		delete workers[i];
+	}
+
+	float seconds = timer.getElapsedTime().asSeconds();
+
+	std::printf("\n%u/%u files, %u thumbnails in %.2fs with %u jobs: %.1f files/s, %.1f thumbnails/s\n",
+				jobs.getSucceededCount(), (unsigned)files.size(), jobs.getThumbnailCount(), seconds,
+				(unsigned)workers.size(), jobs.getSucceededCount() / seconds, jobs.getThumbnailCount() / seconds);
+
+	return (jobs.getSucceededCount() == files.size()) ? 0 : 1;
+}